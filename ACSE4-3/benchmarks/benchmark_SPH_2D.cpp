@@ -0,0 +1,257 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     benchmark_SPH_2D.cpp                                            *
+*  @brief    timing of the phases of a step over a sweep of dx               *
+*  Details.                                                                  *
+*  usage: benchmark_SPH_2D [-r repetitions] [-t threads] [-o file.json]      *
+*                          [-c rows|morton|hilbert] [-s dense|sparse|auto]   *
+*                          [dx ...]                                          *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.10                                                        *
+*  @date     2020/03/15                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <cstring>
+#include "../includes/SPH_2D.h"
+
+// time of one phase over all repetitions
+struct phase_result
+{
+    string name;
+    double min_seconds = 1e300, total_seconds = 0;
+    int repetitions = 0;
+
+    // pairs within 2h at the start of the run, 0 for phases without a pair loop
+    long pairs = 0;
+};
+
+// resolution of one run of the sweep
+struct run_result
+{
+    double dx;
+    size_t particles;
+    long pairs;
+    vector<phase_result> phases;
+
+    // occupied cells and bytes of the cell ranges of the fluid particles
+    int occupied_cells;
+    size_t cell_memory;
+    bool sparse;
+};
+
+// number of pairs of particles within 2h with at least one fluid particle, each pair counted once,
+// the pairs of two boundary particles are never evaluated by the force loops
+static long count_pairs(SPH_main& domain)
+{
+    long pairs = 0;
+
+#pragma omp parallel for reduction(+:pairs) num_threads(domain.num_threads)
+    for (int i = domain.boundary.n; i < int(domain.particle_list.size()); i++)
+    {
+        const SPH_particle& part = domain.particle_list[i];
+        auto count = [&](int first, int last)
+        {
+            for (int m = first; m < last; m++)
+            {
+                double dx = part.x[0] - domain.particle_list[m].x[0];
+                double dy = part.x[1] - domain.particle_list[m].x[1];
+                if (m != i && (m > i || m < domain.boundary.n) && dx * dx + dy * dy < 4 * domain.h * domain.h)
+                    pairs++;
+            }
+        };
+
+        for (int ci = part.list_num[0] - 1; ci <= part.list_num[0] + 1; ci++)
+            for (int cj = part.list_num[1] - 1; cj <= part.list_num[1] + 1; cj++)
+            {
+                if (ci < 0 || ci >= domain.max_list[0] || cj < 0 || cj >= domain.max_list[1])
+                    continue;
+                count(domain.cells.begin(ci, cj), domain.cells.end(ci, cj));
+                count(domain.boundary.cells.begin(ci, cj), domain.boundary.cells.end(ci, cj));
+            }
+    }
+
+    return pairs;
+}
+
+// run phase once to warm up, then repetitions times
+static phase_result time_phase(const string& name, int repetitions, long pairs, const function<void()>& phase)
+{
+    phase_result result;
+    result.name = name;
+    result.pairs = pairs;
+
+    phase();
+
+    for (int r = 0; r < repetitions; r++)
+    {
+        auto start = chrono::steady_clock::now();
+        phase();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        result.min_seconds = min(result.min_seconds, seconds);
+        result.total_seconds += seconds;
+        result.repetitions++;
+    }
+
+    return result;
+}
+
+static const char* order_names[] = { "rows", "morton", "hilbert" };
+static const char* storage_names[] = { "dense", "sparse", "auto" };
+
+static run_result run(double dx, int repetitions, int num_threads, SPH_cell_order order, SPH_cell_storage storage)
+{
+    SPH_main domain;
+    domain.num_threads = num_threads;
+    domain.cell_order = order;
+    domain.cell_storage = storage;
+    domain.set_values(1.3, dx, 1.0);
+    domain.initialise_grid();
+    domain.place_points(domain.min_x, domain.max_x);
+    domain.allocate_to_grid();
+
+    run_result result;
+    result.dx = dx;
+    result.particles = domain.particle_list.size();
+    result.pairs = count_pairs(domain);
+    result.occupied_cells = domain.cells.occupied;
+    result.cell_memory = domain.cells.memory();
+    result.sparse = domain.cells.sparse;
+
+    // phases that leave the particles where they are
+    result.phases.push_back(time_phase("allocate_to_grid", repetitions, 0, [&] { domain.allocate_to_grid(); }));
+    result.phases.push_back(time_phase("neighbour_iterate", repetitions, result.pairs, [&] { domain.compute_forces(false); }));
+    result.phases.push_back(time_phase("neighbour_iterate_stencil", repetitions, result.pairs, [&] { domain.compute_forces(true); }));
+    result.phases.push_back(time_phase("neighbour_iterate_batched", repetitions, result.pairs, [&] { domain.compute_forces_batched(); }));
+    domain.use_work_stealing = true;
+    result.phases.push_back(time_phase("neighbour_iterate_batched_stealing", repetitions, result.pairs, [&] { domain.compute_forces_batched(); }));
+    domain.use_work_stealing = false;
+    result.phases.push_back(time_phase("smoothing", repetitions, result.pairs, [&] { domain.smoothing(); }));
+    result.phases.push_back(time_phase("neighbour_iterate_batched_smoothed", repetitions, result.pairs, [&] { domain.compute_forces_batched(false, true); }));
+
+    // full steps, including allocate_to_grid as the driver calls it
+    result.phases.push_back(time_phase("forward_euler", repetitions, result.pairs, [&] { domain.allocate_to_grid(); domain.forward_euler(false, true); }));
+    result.phases.push_back(time_phase("predictor_corrector", repetitions, result.pairs, [&] { domain.allocate_to_grid(); domain.predictor_corrector(false); }));
+
+    // the same steps on the batched force loop, plain and as a task graph over blocks of cells, which sorts the particles itself
+    domain.use_soa = true;
+    result.phases.push_back(time_phase("forward_euler_batched", repetitions, result.pairs, [&] { domain.allocate_to_grid(); domain.forward_euler(); }));
+    domain.use_pipeline = true;
+    result.phases.push_back(time_phase("forward_euler_pipeline", repetitions, result.pairs, [&] { domain.forward_euler(); }));
+    domain.use_pipeline = false;
+    domain.use_soa = false;
+
+    return result;
+}
+
+static void write_json(ostream& os, const vector<run_result>& runs, int repetitions, int num_threads, SPH_cell_order order, SPH_cell_storage storage)
+{
+    os << "{\n";
+    os << "  \"benchmark\": \"SPH_2D\",\n";
+    os << "  \"compiler\": \"" << __VERSION__ << "\",\n";
+    os << "  \"threads\": " << num_threads << ",\n";
+    os << "  \"repetitions\": " << repetitions << ",\n";
+    os << "  \"batch\": " << SPH_BATCH << ",\n";
+    os << "  \"cell_order\": \"" << order_names[order] << "\",\n";
+    os << "  \"cell_storage\": \"" << storage_names[storage] << "\",\n";
+    os << "  \"runs\": [\n";
+
+    for (size_t r = 0; r < runs.size(); r++)
+    {
+        const run_result& run = runs[r];
+        os << "    {\n";
+        os << "      \"dx\": " << run.dx << ",\n";
+        os << "      \"particles\": " << run.particles << ",\n";
+        os << "      \"pairs\": " << run.pairs << ",\n";
+        os << "      \"occupied_cells\": " << run.occupied_cells << ",\n";
+        os << "      \"cell_memory_bytes\": " << run.cell_memory << ",\n";
+        os << "      \"sparse_cells\": " << (run.sparse ? "true" : "false") << ",\n";
+        os << "      \"phases\": [\n";
+
+        for (size_t p = 0; p < run.phases.size(); p++)
+        {
+            const phase_result& phase = run.phases[p];
+            double mean = phase.total_seconds / phase.repetitions;
+
+            os << "        { \"name\": \"" << phase.name << "\""
+               << ", \"mean_seconds\": " << mean
+               << ", \"min_seconds\": " << phase.min_seconds
+               << ", \"ns_per_particle_step\": " << mean * 1e9 / run.particles;
+            if (phase.pairs > 0)
+                os << ", \"pairs_per_second\": " << phase.pairs / mean;
+            os << " }" << (p + 1 < run.phases.size() ? "," : "") << "\n";
+        }
+
+        os << "      ]\n";
+        os << "    }" << (r + 1 < runs.size() ? "," : "") << "\n";
+    }
+
+    os << "  ]\n";
+    os << "}\n";
+}
+
+int main(int argc, char** argv)
+{
+    int repetitions = 5;
+    int num_threads = 1;
+    SPH_cell_order order = SPH_ORDER_ROWS;
+    SPH_cell_storage storage = SPH_CELLS_AUTO;
+
+    // the results go to a file, cout only shows the progress
+    const char* output = "benchmark_SPH_2D.json";
+    vector<double> dx_list;
+
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "-r") == 0 && a + 1 < argc)
+            repetitions = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-t") == 0 && a + 1 < argc)
+            num_threads = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc)
+            output = argv[++a];
+        else if (strcmp(argv[a], "-c") == 0 && a + 1 < argc)
+        {
+            a++;
+            for (int o = 0; o < 3; o++)
+                if (strcmp(argv[a], order_names[o]) == 0)
+                    order = SPH_cell_order(o);
+        }
+        else if (strcmp(argv[a], "-s") == 0 && a + 1 < argc)
+        {
+            a++;
+            for (int s = 0; s < 3; s++)
+                if (strcmp(argv[a], storage_names[s]) == 0)
+                    storage = SPH_cell_storage(s);
+        }
+        else
+            dx_list.push_back(atof(argv[a]));
+    }
+
+    // about 2,500 to 600,000 particles, dx = 0.005 gives over 2 million
+    if (dx_list.empty())
+        dx_list = { 0.2, 0.1, 0.05, 0.02, 0.01 };
+
+    vector<run_result> runs;
+    for (double dx : dx_list)
+    {
+        runs.push_back(run(dx, repetitions, num_threads, order, storage));
+        cout << "dx = " << dx << " : " << runs.back().particles << " particles, " << runs.back().pairs << " pairs" << endl;
+    }
+
+    ofstream fs(output);
+    write_json(fs, runs, repetitions, num_threads, order, storage);
+    cout << "results written to " << output << endl;
+
+    return 0;
+}
@@ -0,0 +1,213 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     benchmark_SPH_3D.cpp                                            *
+*  @brief    timing of the phases of a step of the dimension templated       *
+*            solver on a dam break, over a sweep of dx                       *
+*  Details.                                                                  *
+*  usage: benchmark_SPH_3D [-d 2|3] [-r repetitions] [-t threads]            *
+*                          [-n steps] [-o file.json] [dx ...]                *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.20                                                        *
+*  @date     2020/03/22                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <cstring>
+#include "../includes/SPH_nd.h"
+
+// time of one phase over all repetitions
+struct phase_result
+{
+    string name;
+    double min_seconds = 1e300, total_seconds = 0;
+    int repetitions = 0;
+
+    // pairs within 2h of the force sweep, 0 for phases without a pair loop
+    long pairs = 0;
+};
+
+// resolution of one run of the sweep
+struct run_result
+{
+    double dx;
+    size_t particles, fluid;
+    long pairs;
+    vector<phase_result> phases;
+
+    // simulated time and wall time of the steps run after the phases
+    int steps = 0;
+    double simulated = 0, seconds = 0;
+};
+
+// run phase once to warm up, then repetitions times
+static phase_result time_phase(const string& name, int repetitions, long pairs, const function<void()>& phase)
+{
+    phase_result result;
+    result.name = name;
+    result.pairs = pairs;
+
+    phase();
+
+    for (int r = 0; r < repetitions; r++)
+    {
+        auto start = chrono::steady_clock::now();
+        phase();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        result.min_seconds = min(result.min_seconds, seconds);
+        result.total_seconds += seconds;
+        result.repetitions++;
+    }
+
+    return result;
+}
+
+// the tank of SPH_main, 20 x 10, with a water column of 3 x 5, extended 5 m along y in 3D
+template <int Dim>
+static run_result run(double dx, int repetitions, int num_threads, int steps)
+{
+    double lower[3] = { 0, 0, 0 }, upper[3] = { 20, 5, 10 };
+    double fluid_lower[3] = { 0, 0, 0 }, fluid_upper[3] = { 3, 5, 5 };
+    if (Dim == 2)
+    {
+        upper[1] = 10;
+        fluid_upper[1] = 5;
+    }
+
+    SPH_solver<Dim> solver;
+    solver.num_threads = num_threads;
+    solver.set_values(1.3, dx, 1.0, lower, upper);
+    solver.initialise_grid();
+    solver.place_points(fluid_lower, fluid_upper);
+    solver.allocate_to_grid();
+    solver.compute_forces();
+
+    run_result result;
+    result.dx = dx;
+    result.particles = solver.size();
+    result.fluid = solver.size() - solver.n_boundary;
+    result.pairs = solver.pairs;
+
+    // phases that leave the particles where they are
+    result.phases.push_back(time_phase("allocate_to_grid", repetitions, 0, [&] { solver.allocate_to_grid(); }));
+    result.phases.push_back(time_phase("compute_forces", repetitions, result.pairs, [&] { solver.compute_forces(); }));
+    result.phases.push_back(time_phase("compute_forces_smoothed", repetitions, result.pairs, [&] { solver.compute_forces(false, true); }));
+
+    // full steps
+    result.phases.push_back(time_phase("forward_euler", repetitions, result.pairs, [&] { solver.forward_euler(false); }));
+    result.phases.push_back(time_phase("predictor_corrector", repetitions, result.pairs, [&] { solver.predictor_corrector(false); }));
+
+    // the dam break itself, with the adaptive time step and smoothing every 20 steps
+    solver.time_step.adaptive = true;
+    auto start = chrono::steady_clock::now();
+    for (int step = 0; step < steps; step++)
+    {
+        solver.predictor_corrector(step % 20 == 0);
+        result.simulated += solver.delta_t;
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    result.steps = steps;
+
+    return result;
+}
+
+static void write_json(ostream& os, const vector<run_result>& runs, int dim, int repetitions, int num_threads)
+{
+    os << "{\n";
+    os << "  \"benchmark\": \"SPH_" << dim << "D\",\n";
+    os << "  \"compiler\": \"" << __VERSION__ << "\",\n";
+    os << "  \"threads\": " << num_threads << ",\n";
+    os << "  \"repetitions\": " << repetitions << ",\n";
+    os << "  \"runs\": [\n";
+
+    for (size_t r = 0; r < runs.size(); r++)
+    {
+        const run_result& run = runs[r];
+        os << "    {\n";
+        os << "      \"dx\": " << run.dx << ",\n";
+        os << "      \"particles\": " << run.particles << ",\n";
+        os << "      \"fluid\": " << run.fluid << ",\n";
+        os << "      \"pairs\": " << run.pairs << ",\n";
+        os << "      \"steps\": " << run.steps << ",\n";
+        os << "      \"simulated_seconds\": " << run.simulated << ",\n";
+        os << "      \"wall_seconds\": " << run.seconds << ",\n";
+        os << "      \"phases\": [\n";
+
+        for (size_t p = 0; p < run.phases.size(); p++)
+        {
+            const phase_result& phase = run.phases[p];
+            double mean = phase.total_seconds / phase.repetitions;
+
+            os << "        { \"name\": \"" << phase.name << "\""
+               << ", \"mean_seconds\": " << mean
+               << ", \"min_seconds\": " << phase.min_seconds
+               << ", \"ns_per_particle_step\": " << mean * 1e9 / run.particles;
+            if (phase.pairs > 0)
+                os << ", \"pairs_per_second\": " << phase.pairs / mean;
+            os << " }" << (p + 1 < run.phases.size() ? "," : "") << "\n";
+        }
+
+        os << "      ]\n";
+        os << "    }" << (r + 1 < runs.size() ? "," : "") << "\n";
+    }
+
+    os << "  ]\n";
+    os << "}\n";
+}
+
+int main(int argc, char** argv)
+{
+    int dim = 3;
+    int repetitions = 5;
+    int num_threads = 1;
+    int steps = 100;
+    const char* output = nullptr;
+    vector<double> dx_list;
+
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "-d") == 0 && a + 1 < argc)
+            dim = atoi(argv[++a]) == 2 ? 2 : 3;
+        else if (strcmp(argv[a], "-r") == 0 && a + 1 < argc)
+            repetitions = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-t") == 0 && a + 1 < argc)
+            num_threads = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-n") == 0 && a + 1 < argc)
+            steps = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc)
+            output = argv[++a];
+        else
+            dx_list.push_back(atof(argv[a]));
+    }
+
+    // about 17,000 and 59,000 particles in 3D, most of them in the walls
+    if (dx_list.empty())
+        dx_list = { 0.5, 0.25 };
+
+    vector<run_result> runs;
+    for (double dx : dx_list)
+    {
+        runs.push_back(dim == 2 ? run<2>(dx, repetitions, num_threads, steps) : run<3>(dx, repetitions, num_threads, steps));
+        const run_result& result = runs.back();
+        cout << "dx = " << dx << " : " << result.particles << " particles, " << result.fluid << " fluid, "
+             << result.pairs << " pairs, " << result.steps << " steps to t = " << result.simulated
+             << " in " << result.seconds << " s" << endl;
+    }
+
+    string name = output ? output : "benchmark_SPH_" + to_string(dim) + "D.json";
+    ofstream fs(name);
+    write_json(fs, runs, dim, repetitions, num_threads);
+    cout << "results written to " << name << endl;
+
+    return 0;
+}
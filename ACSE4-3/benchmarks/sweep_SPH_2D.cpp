@@ -0,0 +1,105 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     sweep_SPH_2D.cpp                                                *
+*  @brief    runs the simulations of a parameter sweep concurrently          *
+*  Details.                                                                  *
+*  usage: sweep_SPH_2D [-j workers] [-t threads] [-s snapshot_interval]      *
+*                      [-n] [-o summary.csv] sweep.txt                       *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.17                                                        *
+*  @date     2020/03/20                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#include <chrono>
+#include <fstream>
+#include <cstring>
+#include <thread>
+#include "../includes/SPH_2D.h"
+#include "../includes/SPH_sweep.h"
+
+// every line of sweep.txt is one run, "name dx h_factor t_max fe|pc [geometry]", whose files all start with "name_".
+// -j sets the number of runs at the same time (default: one per core), -t the OpenMP threads of each (default 1),
+// -s the steps between two snapshots (default 0, none), -n skips the analytics files
+int main(int argc, char** argv)
+{
+    int workers = max(1, int(thread::hardware_concurrency()));
+    int num_threads = 1;
+    int snapshot_interval = 0;
+    bool analytics = true;
+    const char* output = "sweep_summary.csv";
+    const char* input = nullptr;
+
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "-j") == 0 && a + 1 < argc)
+            workers = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-t") == 0 && a + 1 < argc)
+            num_threads = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-s") == 0 && a + 1 < argc)
+            snapshot_interval = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-n") == 0)
+            analytics = false;
+        else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc)
+            output = argv[++a];
+        else
+            input = argv[a];
+    }
+
+    vector<SPH_run_config> configs;
+    if (input == nullptr)
+    {
+        cerr << "usage: sweep_SPH_2D [-j workers] [-t threads] [-s snapshot_interval] [-n] [-o summary.csv] sweep.txt" << endl;
+        return 1;
+    }
+    if (read_sweep(input, configs))
+        return 1;
+
+    for (SPH_run_config& config : configs)
+    {
+        config.num_threads = num_threads;
+        config.snapshot_interval = snapshot_interval;
+        config.analytics = analytics;
+    }
+
+    cout << configs.size() << " runs on " << workers << " workers" << endl;
+    auto start = chrono::steady_clock::now();
+    vector<SPH_run_summary> summaries = run_sweep(configs, workers);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    ofstream fs(output);
+    if (!fs)
+    {
+        cerr << "could not write " << output << endl;
+        return 1;
+    }
+    fs << "name,dx,h_factor,scheme,particles,steps,time,seconds,ns_per_particle_step,kinetic_energy,max_velocity,surge_front\n";
+
+    int failed = 0;
+    double run_seconds = 0;
+    for (size_t r = 0; r < configs.size(); r++)
+    {
+        const SPH_run_config& config = configs[r];
+        const SPH_run_summary& summary = summaries[r];
+        fs << summary.name << ',' << config.dx << ',' << config.h_factor << ',' << (config.predictor_corrector ? "pc" : "fe")
+           << ',' << summary.particles << ',' << summary.steps << ',' << summary.time << ',' << summary.seconds
+           << ',' << summary.ns_per_particle_step << ',' << summary.kinetic_energy << ',' << summary.max_velocity
+           << ',' << summary.surge_front << '\n';
+        failed += summary.status;
+        run_seconds += summary.seconds;
+    }
+
+    // the sum of the run times over the wall time is how many runs were effectively running at once
+    cout << "sweep took " << seconds << " seconds for " << run_seconds << " seconds of runs, a speed-up of "
+         << (seconds > 0 ? run_seconds / seconds : 0) << endl;
+    cout << "summary written to " << output << endl;
+
+    return failed > 0;
+}
@@ -42,6 +42,15 @@
 #include <iostream>
 #include <string>
 #include <algorithm>
+#include "SPH_soa.h"
+#include "SPH_cell_list.h"
+#include "SPH_boundary.h"
+#include "SPH_verlet.h"
+#include "SPH_kernel.h"
+#include "SPH_trace.h"
+#include "SPH_time_step.h"
+#include "SPH_geometry.h"
+#include "SPH_scheduler.h"
 
 #define mu 0.001
 #define G - 9.81
@@ -53,7 +62,6 @@
 
 using namespace std;
 
-class SPH_main;
 
 /*
 * @brief
@@ -63,45 +71,54 @@ class SPH_main;
 * represents the properties of particles, such as position,
 * velocity, acceleration, pressure, density, differentiation of
 * density to time and whether it is a boundary particle or fluid particle.
+*
+* The fields are grouped by how often they are touched: the hot fields are
+* read for every pair of the force loops and come first, the warm fields are
+* written by the force loops and read by the integration, and the cold fields
+* are bookkeeping of the grid, the boundary and the output, read once per
+* particle and step at most. The state at the start of a predictor corrector
+* step is kept by SPH_main, and only by that scheme, so a particle takes 96
+* bytes instead of the 144 it took with the previous state in it.
 */
 class SPH_particle
 {
 public:
-    // position and velocity
+    // hot: position and velocity
     double x[2], v[2] = { 0, 0 };
 
-    // density and pressure
+    // hot: density and pressure
     double rho = 1000, P = 0;
 
-    // acceleration
+    // warm: acceleration
     double a[2];
 
-    // differentiation of density to time
+    // warm: differentiation of density to time
     double D;
 
-    // link to SPH_main class so that it can be used in calc_index
-    static SPH_main* main_data;
-
-    // store previous position for predictor corrector scheme
-    double prev_x[2];
+    // cold: index in neighbour finding array
+    int list_num[2];
 
-    // store previous velocity for predictor corrector scheme
-    double prev_v[2];
+    // cold: get the index of particle in his grid, which is used for stencil neighbour particles finding algorithm
+    unsigned int grid_index = 0;
 
-    // store previous densiity for predictor corrector scheme
-    double prev_rho;
+    // cold: number given when the particle is placed, kept while the particles are reordered
+    int id = 0;
 
-    //index in neighbour finding array
-    int list_num[2];
+    // cold: level of its individual time step, the particle computes its forces every 2^(step_levels - level) steps
+    int level = 0;
 
-    // whether the particle is a boundary or fluid particle
+    // cold: whether the particle is a boundary or fluid particle
     bool boundary_status = false;
 
-    // get the index of particle in his grid, which is used for stencil neighbour particles finding algorithm
-    unsigned int grid_index = 0;
+    // cold: whether the particle is a copy of a particle owned by another MPI process
+    bool ghost = false;
 
-    // calculate the grid index of particle
-    void calc_index(void);
+    /*
+    * @brief calculate the grid index of particle
+    * @param[in] min_x          lower corner of the domain of its simulation
+    * @param[in] h              smoothing length of its simulation, the cells are 2h wide
+    */
+    void calc_index(const double* min_x, double h);
 
     // update pressure for particle
     void calculate_P()
@@ -135,8 +152,11 @@ public:
     // the upper limit of time you want to simulate
     double t_max;
 
-    // three time calculated for update time stepping for predictor corrector algorithm
-    double dt_cfl = 10, dt_f = 10, dt_a = 10;
+    // smallest CFL, force and acoustic limits found by the last step that updated delta_t
+    double dt_cfl = SPH_DT_NONE, dt_f = SPH_DT_NONE, dt_a = SPH_DT_NONE;
+
+    // adaptive time step settings, used when a step updates delta_t
+    SPH_time_step time_step;
 
     // dimensions of simulation region
     double min_x[2], max_x[2];
@@ -147,15 +167,116 @@ public:
     // the upper limit number of grid index in two dimension
     int max_list[2];
 
-    // list of all the particles
+    // list of all the particles, the boundary particles first
     vector<SPH_particle> particle_list;
 
-    // Outer 2 are the grid, inner vector is the list of pointers in each cell
-    vector<vector<vector<SPH_particle*> > > search_grid;
+    // flat cell list of the fluid particles, which are kept sorted by cell so the particles of a cell are contiguous
+    SPH_cell_list cells;
 
-public:
-    SPH_main();
+    // layout of the cells in particle_list, a space filling curve keeps neighbouring cells close in memory on large grids
+    SPH_cell_order cell_order = SPH_ORDER_ROWS;
+
+    // storage of the cell ranges, the hash of the occupied cells saves the memory and the scan of the empty cells of sparse domains
+    SPH_cell_storage cell_storage = SPH_CELLS_AUTO;
+
+    // the boundary particles at the front of particle_list, binned once as they never move
+    SPH_boundary_set boundary;
+
+    // structure of arrays copy of the hot particle fields used by the batched force loop
+    SPH_soa soa;
+
+    // whether the force loop runs on the structure of arrays in SIMD-width batches
+    bool use_soa = false;
+
+    // number of OpenMP threads used by the force loop, smoothing and integration, OMP_NUM_THREADS unless set
+    int num_threads = omp_get_max_threads();
+
+    // Verlet neighbour lists, reused until a particle has moved further than half the skin
+    SPH_verlet_list verlet;
+
+    // whether the force loop and smoothing use the Verlet lists, the skin is set to 0.2h in set_values
+    bool use_verlet = false;
+
+    // whether the batched and Verlet force sweeps run tiles of cells as tasks on a work stealing scheduler
+    bool use_work_stealing = false;
+
+    // side of the square tiles of cells of one task
+    int tile_cells = 16;
+
+    // scheduler of the tile tasks
+    SPH_work_stealing scheduler;
+
+    // pairs found in every tile by the last sweep, the estimated cost of its task in the next
+    vector<long> tile_pairs;
+
+    // tiles with particles in them and the estimated cost of each, the tasks of the current sweep
+    vector<int> tile_tasks;
+    vector<double> tile_cost;
+
+    // first and last particle of the ranges of every task, the ranges of task k starting at tile_range_start[k]
+    vector<int> tile_ranges, tile_range_start;
+
+    // whether the steps without smoothing run the grid rebuild, forces and integration of blocks of cells as one task graph
+    bool use_pipeline = false;
+
+    // columns of cells in one block of the task graph, at least 2
+    int block_columns = 4;
+
+    // tasks of the pipelined step and their dependencies
+    SPH_task_graph graph;
+
+    // first particle of every block in the last step, and the fluid particles counted into every block and their first one
+    vector<int> block_old_start, block_count, block_start;
+
+    // occupied cells, limits and pair counts of every block, and whether one of its particles left the blocks next to it
+    vector<int> block_occupied;
+    vector<char> block_far;
+    vector<double> block_cfl, block_force, block_acoustic;
+    vector<long> block_candidates, block_pairs;
+
+    // cell in layout order of every fluid particle after the integration of the last pipelined step, read by the sort instead
+    // of list_num, and the same for the current step, written while other blocks still sort
+    vector<int> moved_cell, next_cell;
+
+    // whether particle_list is sorted by the cells of the last pipelined step and no particle has moved more than one block since
+    bool pipeline_sorted = false;
+
+    // position, velocity and density of every particle at the start of the step, only allocated by predictor_corrector
+    vector<double> prev_x[2], prev_v[2], prev_rho;
+
+    // whether the batched force loop only computes the particles whose individual time step starts, the others keep their forces
+    bool use_individual_steps = false;
+
+    // number of levels finer than the coarsest, a particle of level l computes its forces every 2^(step_levels - l) steps of delta_t
+    int step_levels = 3;
+
+    // step within the cycle of 2^step_levels steps, all particles compute their forces at step 0
+    long sub_step = 0;
+
+    // particles that computed their forces in the last step
+    int n_active = 0;
+
+    // per particle of the current step: whether it computes its forces, the finest level around it minus one, and its time step limit
+    vector<char> step_active;
+    vector<int> level_floor;
+    vector<double> step_limit;
+
+    // finest level of the fluid and of the boundary particles of every occupied cell, indexed by the slot of the cell in cells and boundary.cells
+    vector<char> cell_level, boundary_level;
+
+    // smoothed densities, written separately so that smoothing does not read half updated values
+    vector<double> rho_smoothed;
+
+    // smoothing kernel used by the force loops and smoothing
+    SPH_kernel_type kernel = SPH_KERNEL_CUBIC;
 
+    // whether the kernel is interpolated from a table instead of evaluated
+    bool tabulate_kernel = false;
+
+    // per step timings and counters, written once trace.open has been called
+    SPH_trace trace;
+
+public:
     /*
     * @brief set basic parameters for particles and environment
     * @param[in] h_factor       factor to compute h
@@ -166,13 +287,13 @@ public:
 
 
     /*
-    * @brief set the size of region and initialise the search_grid to construct the grids
+    * @brief set the size of region and initialise the cell list to construct the grids
     */
     void initialise_grid(void);
 
 
     /*
-    * @brief set all the partilces in the region including fliud partilces and voundary particles
+    * @brief set all the partilces of the dam break (SPH_geometry::dam_break) including fliud partilces and voundary particles
     * @param[in] min            the array of lower bound of region for two dimension
     * @param[in] max            the array of upper bound of region for two dimension
     */
@@ -180,7 +301,21 @@ public:
 
 
     /*
-    * @brief allocates all the points to the search grid (assumes that index has been appropriately updated)
+    * @brief append the particles of a geometry on the lattice of spacing dx from min to max
+    * @param[in] geometry       shapes of the fluid and boundary particles
+    * @param[in] min            the array of lower bound of region for two dimension
+    * @param[in] max            the array of upper bound of region for two dimension
+    */
+    void place_points(const SPH_geometry& geometry, double* min, double* max);
+
+
+    /*
+    * @brief allocates all the points to the cell list and reorders particle_list by cell (assumes that index has been appropriately updated)
+    *
+    * @detail
+    * the boundary particles are only moved to the front and binned when boundary.binned has been reset, every
+    * other call sorts just the fluid particles behind them. With use_verlet the particles are only reordered, and the Verlet lists rebuilt, when a particle has moved
+    * further than half the skin since the last build
     */
     void allocate_to_grid(void);
 
@@ -196,25 +331,205 @@ public:
 
 
     /*
-    * @brief iterates over all particles within 2h of part
+    * @brief iterates over all particles within 2h of part, lowering dt_cfl to the CFL limit of the pairs found
     * @param[in] part                   target particle
     * @param[in] stencil                whether it is a stencil finding neighbour algorithm
-    * @param[in] change_delta_t         whether it is predictor corrector algorithm which need to update the dt
     */
-    void neighbour_iterate(SPH_particle* part, bool stencil = false, bool change_delta_t = false);
+    void neighbour_iterate(SPH_particle* part, bool stencil = false);
 
 
     /*
-    * @brief iterates over all particles within 2h of part for non stencil algorithm
+    * @brief iterates over all particles within 2h of part for non stencil algorithm, only the fluid ones if part is a boundary particle
+    *
+    * @detail
+    * only part is written, so the particles can be iterated in parallel
+    *
     * @param[in] part                   target particle
-    * @param[in] stencil                whether it is a stencil finding neighbour algorithm
-    * @param[in] change_delta_t         whether it is predictor corrector algorithm which need to update the dt
+    * @param[in,out] cfl                minimum dt_cfl of the pairs found so far
+    * @param[in,out] candidates         number of particles whose distance was computed
+    * @param[in,out] pairs              number of pairs within 2h
+    */
+    void neighbour_iterate_non_stencil(SPH_particle* part, double& cfl, long& candidates, long& pairs);
+
+
+    /*
+    * @brief iterates over the fluid particles of the 5-cell stencil that come after part and the boundary particles
+    *        of all 9 cells around it, updating both particles of every pair
+    * @param[in] part                   target fluid particle
+    * @param[in,out] cfl                minimum dt_cfl of the pairs found so far
+    * @param[in,out] candidates         number of candidate pairs looked at
+    * @param[in,out] pairs              number of pairs within 2h
+    * @param[in] smooth                 whether to add W of every pair to the Shepard sums of both particles
+    */
+    void neighbour_iterate_stencil(SPH_particle* part, double& cfl, long& candidates, long& pairs, bool smooth = false);
+
+
+    /*
+    * @brief compute the acceleration and density change of all particles on particle_list
+    *
+    * @detail
+    * the stencil path only runs over the fluid particles, which also visit the boundary particles of all 9
+    * cells around them. It colours the cells with 3 colours in x and 3 in y, so two cells of one colour never
+    * write to the same cell, and the cells of one colour are processed in parallel while every pair is still
+    * visited only once.
+    *
+    * With smooth the stencil path also accumulates the Shepard sums of every pair into both particles and
+    * replaces the densities by the smoothed ones after the sweep, so smoothing needs no traversal of its own.
+    * The non-stencil path calls smoothing before the sweep instead.
+    *
+    * @param[in] stencil                whether it applies stencil finding neighbour algorithm
+    * @param[in] change_delta_t         whether to update delta_t from the limits of this step
+    * @param[in] smooth                 whether to smooth the density in this sweep
+    */
+    void compute_forces(bool stencil = false, bool change_delta_t = false, bool smooth = false);
+
+
+    /*
+    * @brief start the Shepard sums of every particle with its own contribution and those of the boundary pairs
+    */
+    void begin_shepard();
+
+
+    /*
+    * @brief replace the density of every particle by its Shepard sum
+    */
+    void finish_shepard();
+
+
+    /*
+    * @brief smallest force and acoustic limits over all particles, from their final acceleration and density
+    * @param[out] force                 smallest force limit
+    * @param[out] acoustic              smallest acoustic limit
+    */
+    void particle_limits(double& force, double& acoustic);
+
+
+    /*
+    * @brief store the limits of this step in dt_cfl, dt_f and dt_a and set delta_t through time_step
+    * @param[in] cfl                    smallest CFL limit
+    * @param[in] force                  smallest force limit
+    * @param[in] acoustic               smallest acoustic limit
+    * @param[in] steps                  steps taken with delta_t since it was last set
+    * @param[in] grow                   whether delta_t may grow, otherwise it is only set when the limits make it smaller
+    */
+    void set_delta_t(double cfl, double force, double acoustic, int steps = 1, bool grow = true);
+
+
+    /*
+    * @brief compute the acceleration and density change of one particle from a contiguous range of candidate
+    *        neighbours in batches of SPH_BATCH, reading and writing the structure of arrays soa. Only the
+    *        density change is accumulated unless fluid is set
+    * @param[in] i                      index of target particle
+    * @param[in] first                  index of the first candidate neighbour
+    * @param[in] last                   index after the last candidate neighbour
+    * @param[in,out] cfl                minimum dt_cfl of the pairs found so far
+    * @param[in,out] candidates         number of candidate pairs looked at
+    * @param[in,out] pairs              number of pairs within 2h
+    */
+    template <class Kernel, bool smooth, bool fluid>
+    void update_a_D_batch(int i, int first, int last, double& cfl, long& candidates, long& pairs);
+
+
+    /*
+    * @brief run the batched pair kernel of particle i over its 3x3 cells, which are three contiguous ranges
+    *        of fluid particles and, for a fluid particle, three of boundary particles
+    * @param[in] i                      index of target particle
+    * @param[in,out] cfl                minimum dt_cfl of the pairs found so far
+    * @param[in,out] candidates         number of candidate pairs looked at
+    * @param[in,out] pairs              number of pairs within 2h
     */
-    void neighbour_iterate_non_stencil(SPH_particle* part, bool stencil, bool change_delta_t);
+    template <class Kernel, bool smooth, bool fluid>
+    void neighbour_iterate_batched(int i, double& cfl, long& candidates, long& pairs);
 
 
     /*
-    * @brief W in cubic spline
+    * @brief call particle(i, cfl, force, acoustic, candidates, pairs) for every particle, tile by tile on the work stealing scheduler
+    *
+    * @detail
+    * a task is a tile of tile_cells x tile_cells cells with the fluid and boundary particles in them. Its cost is
+    * estimated from the pairs it found in the last sweep, and at least one per particle, and the scheduler splits
+    * the tiles between the threads by that estimate; the threads that run out of tiles steal from the others.
+    * particle must only write the accumulators of particle i
+    */
+    template <class Particle>
+    void sweep_tiles(Particle particle, double& cfl, double& force, double& acoustic, long& candidates, long& pairs);
+
+
+    /*
+    * @brief run the batched pair kernel of particle i and take its time step limits
+    * @param[in] i                      index of target particle
+    * @param[in] change_delta_t         whether to take the force and acoustic limits of the particle
+    * @param[in,out] cfl                minimum dt_cfl of the pairs found so far
+    * @param[in,out] force              minimum force limit so far
+    * @param[in,out] acoustic           minimum acoustic limit so far
+    * @param[in,out] candidates         number of candidate pairs looked at
+    * @param[in,out] pairs              number of pairs within 2h
+    */
+    template <class Kernel, bool smooth>
+    void batched_particle(int i, bool change_delta_t, double& cfl, double& force, double& acoustic, long& candidates, long& pairs);
+
+
+    /*
+    * @brief choose the particles that compute their forces in this step of the individual time steps
+    *
+    * @detail
+    * a particle of level l computes its forces when sub_step is a multiple of 2^(step_levels - l). A particle
+    * more than one level coarser than the finest particle in the 3x3 cells around it is woken up, moved to
+    * that level minus one and computes its forces right away, so a fast particle never comes close to one
+    * that keeps old forces for long
+    *
+    * @param[in] all                    whether all particles compute their forces, as for smoothing
+    */
+    void activate_particles(bool all);
+
+
+    /*
+    * @brief move the particles that computed their forces to the coarsest level within their limit and start the next step of the cycle
+    *
+    * @detail
+    * the level is the coarsest one whose step, delta_t * 2^(step_levels - level), is within safety times the
+    * smallest limit of the particle, but not coarser than the woken level, and only coarser than the current
+    * one if sub_step starts a step of the new level
+    */
+    void assign_levels();
+
+
+    /*
+    * @brief compute the acceleration and density change of all particles through the structure of arrays
+    *
+    * @detail
+    * with use_individual_steps only the particles chosen by activate_particles are computed, the others keep the
+    * acceleration and density change of their last step. delta_t, the step of the finest level, only grows at
+    * the start of a cycle, when all particles are computed, and shrinks as soon as a computed particle needs a
+    * smaller step. Every particle still moves with delta_t
+    *
+    * @param[in] change_delta_t         whether to update delta_t, the limits of every particle are taken in the sweep
+    * @param[in] smooth                 whether to smooth the density with the kernel values of the same sweep
+    */
+    void compute_forces_batched(bool change_delta_t = false, bool smooth = false);
+
+
+    /*
+    * @brief run the batched pair kernel of particle i over its Verlet list
+    * @param[in] i                      index of target particle
+    * @param[in,out] cfl                minimum dt_cfl of the pairs found so far
+    * @param[in,out] candidates         number of candidate pairs looked at
+    * @param[in,out] pairs              number of pairs within 2h
+    */
+    template <class Kernel, bool smooth, bool fluid>
+    void update_a_D_verlet(int i, double& cfl, long& candidates, long& pairs);
+
+
+    /*
+    * @brief compute the acceleration and density change of all particles from the Verlet lists
+    * @param[in] change_delta_t         whether to update delta_t, the limits of every particle are taken in the sweep
+    * @param[in] smooth                 whether to smooth the density with the kernel values of the same sweep
+    */
+    void compute_forces_verlet(bool change_delta_t = false, bool smooth = false);
+
+
+    /*
+    * @brief W of the selected kernel
     * @param[in] r                   distance between target particle and neibour particle
     *
     * @return value of W for later computation
@@ -223,7 +538,7 @@ public:
 
 
     /*
-    * @brief differentiation of W in cubic spline
+    * @brief differentiation of W of the selected kernel
     * @param[in] r                   distance between target particle and neibour particle
     *
     * @return value of dW for later computation
@@ -232,11 +547,12 @@ public:
 
 
     /*
-    * @brief compute the updated time stepping
+    * @brief lower cfl to the CFL limit of a pair
     * @param[in] part                   target particle
     * @param[in] other_part             neighbour particle
+    * @param[in,out] cfl                minimum dt_cfl of the pairs found so far
     */
-    void update_dynamical_t(SPH_particle* part, SPH_particle* other_part);
+    void update_dynamical_t(SPH_particle* part, SPH_particle* other_part, double& cfl);
 
 
     /*
@@ -251,23 +567,96 @@ public:
 
     /*
     * @brief reset the density for every particle by computing neibour particles and itself
+    *
+    * @detail
+    * a separate traversal of the neighbours, the schemes smooth within the force sweep instead
     */
     void smoothing();
 
 
     /*
     * @brief forward euler scheme which apply push back scheme to deal with the fliud particles which are going to leak
+    *
+    * @detail
+    * the boundary particles only update their density and pressure. With time_step.adaptive the step is taken with delta_t from the limits of the current state
+    * With use_pipeline the steps without smoothing are taken by step_pipeline
+    *
     * @param[in] smooth              whether it needs to smooth density for this update
     * @param[in] stencil             whether it applies stencil finding neighbour algorithm
     */
     void forward_euler(bool smooth = false, bool stencil = false);
 
 
+    /*
+    * @brief forward euler update of particle i from its acceleration and density change, and its new cell
+    * @param[in] i                   index of the particle, a boundary particle only updates its density and pressure
+    */
+    void euler_particle(int i);
+
+
+    /*
+    * @brief size the state at the start of the step kept by predictor_corrector for every particle
+    */
+    void allocate_previous_state();
+
+
+    /*
+    * @brief half step of the predictor corrector scheme for particle i, storing the state at the start of the step
+    * @param[in] i                   index of the particle
+    */
+    void predict_particle(int i);
+
+
+    /*
+    * @brief full step of the predictor corrector scheme for particle i from the state stored by predict_particle
+    * @param[in] i                   index of the particle
+    */
+    void correct_particle(int i);
+
+
+    /*
+    * @brief whether the next step can run as a task graph, which needs use_pipeline, the batched force loop
+    *        without Verlet lists or individual time steps, no smoothing, the dense storage of the cells in row order,
+    *        and no time_step.reduce_min, as the limits task that calls it runs on any of the OpenMP threads
+    * @param[in] smooth              whether the step smooths the density
+    */
+    bool pipeline_supported(bool smooth) const;
+
+
+    /*
+    * @brief one step of either scheme as a task graph over blocks of block_columns columns of cells
+    *
+    * @detail
+    * the particles can only move to the blocks next to their own in one step, so every block has five tasks:
+    * count the particles of the three blocks around it that now lie in its cells, add its count to the start
+    * of the previous block, sort those particles into its cells and gather them into soa, compute the forces
+    * of its particles once the blocks next to it are sorted, and integrate them. The integration reads the
+    * accumulators in soa and writes particle_list, which no other block reads, so it only waits for the
+    * forces of its own block, or with a new delta_t for a task that takes the limits of all blocks. There is
+    * no barrier between the phases, and the counting, sorting and forces of some blocks overlap the
+    * integration of others. Without the cells of the last pipelined step the particles are first sorted by
+    * allocate_to_grid, and a particle that moved further than one block turns that sort on for the next step.
+    * The results are the same as those of the plain step, and the whole step is timed as forces in the trace.
+    *
+    * @param[in] predictor_corrector whether to take a predictor corrector step instead of forward euler
+    * @param[in] change_delta_t      whether to update delta_t from the limits of this step
+    *
+    * @return false without taking the step if the cells have just switched to the sparse storage
+    */
+    bool step_pipeline(bool predictor_corrector, bool change_delta_t);
+
+
     /*
     * @brief predictor corrector scheme which apply push back scheme to deal with the fliud particles which are going to leak
+    *
+    * @detail
+    * the half and full step of every particle only use its own state, so they follow each other particle by particle
+    * in step_pipeline, which takes the steps without smoothing with use_pipeline
+    *
     * @param[in] smooth              whether it needs to smooth density for this update
-    * @param[in] change_delta_t      it is predictor corrector algorithm which need to update the dt
+    * @param[in] change_delta_t      whether to update delta_t for this step, always done with time_step.adaptive
+    * @param[in] stencil             whether it applies stencil finding neighbour algorithm
     */
-    void predictor_corrector(bool smooth = false, bool change_delta_t = false);
+    void predictor_corrector(bool smooth = false, bool change_delta_t = false, bool stencil = false);
 };
 
@@ -0,0 +1,104 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     SPH_analytics.h                                                 *
+*  @brief    reductions over the particles written as a time series          *
+*  Details.                                                                  *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.16                                                        *
+*  @date     2020/03/19                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#pragma once
+#include <fstream>
+#include <string>
+#include <vector>
+
+class SPH_main;
+
+// quantities written by SPH_analytics, combined with |
+enum SPH_quantity
+{
+    SPH_KINETIC_ENERGY = 1,     // sum of m v^2 / 2 over the fluid particles
+    SPH_MAX_VELOCITY = 2,       // largest |v| of a fluid particle
+    SPH_SURGE_FRONT = 4,        // largest x of a fluid particle above front_height
+    SPH_WALL_PRESSURE = 8,      // force per unit width and largest pressure on the right wall
+    SPH_DENSITY_ERROR = 16,     // histogram of |rho - rho0| / rho0 over the fluid particles
+    SPH_ALL_QUANTITIES = 31
+};
+
+/*
+* @brief
+* in-situ analytics of a run
+*
+* @detail
+* record reduces the particles in one parallel pass and appends one CSV row per
+* call, so the quantities most post-processing needs are available for every
+* step without writing the particles. The right wall is the first column of
+* boundary particles behind inner_max_x[0], and its force is the sum of their
+* pressures times dx. Ghost particles are skipped; under MPI reduce_sum and
+* reduce_max combine the partial results of all processes, every process has
+* to call record, and only the one that opened the file writes.
+*/
+class SPH_analytics
+{
+public:
+    // whether record computes anything
+    bool enabled = false;
+
+    // quantities written, a combination of SPH_quantity
+    unsigned quantities = SPH_ALL_QUANTITIES;
+
+    // steps between two rows
+    int interval = 1;
+
+    // fluid particles above this height count for the surge front, the depth of the water ahead of the dam
+    double front_height = 2.0;
+
+    // number of bins of the density error histogram, the last one also holds every larger error
+    int bins = 10;
+
+    // density error covered by the histogram
+    double max_error = 0.2;
+
+    // optional sums and maxima over all processes, in place
+    void (*reduce_sum)(double* values, int n) = nullptr;
+    void (*reduce_max)(double* values, int n) = nullptr;
+
+    // results of the last record
+    double kinetic_energy = 0, max_velocity = 0, surge_front = 0, wall_force = 0, wall_max_pressure = 0;
+    std::vector<double> density_error;
+
+    ~SPH_analytics();
+
+    /*
+    * @brief start writing the time series to filename
+    * @param[in] filename       CSV file
+    * @param[in] append         continue an existing file of a restarted run instead of starting a new one
+    * @return 0 on success, 1 if the file could not be opened
+    */
+    int open(const std::string& filename, bool append = false);
+
+    /*
+    * @brief finish the file
+    */
+    void close();
+
+    /*
+    * @brief reduce the particles of domain and write one row if step is a multiple of interval
+    * @param[in] domain         simulation after the step
+    * @param[in] time           simulated time after the step
+    * @param[in] step           number of the step
+    */
+    void record(const SPH_main& domain, double time, int step);
+
+private:
+    std::ofstream file;
+};
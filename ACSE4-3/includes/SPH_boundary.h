@@ -0,0 +1,68 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     SPH_boundary.h                                                  *
+*  @brief    static boundary particles binned once                           *
+*  Details.                                                                  *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.14                                                        *
+*  @date     2020/03/18                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#pragma once
+#include <vector>
+#include "SPH_cell_list.h"
+
+class SPH_particle;
+
+/*
+* @brief
+* boundary particles, kept at the front of the particle list
+*
+* @detail
+* boundary particles never move, so they are moved to the front of the particle
+* list once, binned into their own cell list once, and never reordered again.
+* The cell list of SPH_main only sorts the fluid particles behind them. A pair of
+* two boundary particles has no relative velocity, so it changes neither
+* acceleration nor density; the force loops only visit pairs with a fluid
+* particle. The density smoothing still needs the boundary pairs, and as their
+* distances never change they are listed here with the distance of every pair.
+*/
+class SPH_boundary_set
+{
+public:
+    // number of boundary particles, which are particle_list[0] to particle_list[n - 1]
+    int n = 0;
+
+    // whether the boundary particles are at the front and binned, reset whenever particles are added or removed
+    bool binned = false;
+
+    // cell list over the boundary particles
+    SPH_cell_list cells;
+
+    // boundary neighbours within 2h of every boundary particle in compressed sparse row form, as in SPH_verlet_list
+    std::vector<int> start, neighbours;
+
+    // distance of every pair in neighbours
+    std::vector<double> dist;
+
+    /*
+    * @brief move the boundary particles to the front of particle_list, keeping their order, bin them and list their pairs
+    * @param[in] particle_list  particles with up to date list_num, reordered on return
+    * @param[in] nx             number of cells in x
+    * @param[in] ny             number of cells in y
+    * @param[in] h              smoothing length
+    * @param[in] num_threads    number of OpenMP threads
+    * @param[in] order          layout of the cells, the same as for the fluid particles
+    * @param[in] storage        storage of the cell ranges, the walls of a large tank occupy few of its cells
+    */
+    void build(std::vector<SPH_particle>& particle_list, int nx, int ny, double h, int num_threads = 1,
+        SPH_cell_order order = SPH_ORDER_ROWS, SPH_cell_storage storage = SPH_CELLS_AUTO);
+};
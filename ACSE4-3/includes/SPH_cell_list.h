@@ -0,0 +1,244 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     SPH_cell_list.h                                                 *
+*  @brief    flat cell list built by counting sort                           *
+*  Details.                                                                  *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.3                                                         *
+*  @date     2020/03/06                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#pragma once
+#include <vector>
+#include <cstddef>
+
+class SPH_particle;
+
+// order in which the cells are laid out in the particle list
+enum SPH_cell_order { SPH_ORDER_ROWS, SPH_ORDER_MORTON, SPH_ORDER_HILBERT };
+
+// side of the square tiles of cells ordered along the space filling curves
+#define SPH_CELL_TILE 8
+
+// how the ranges of the cells are stored: an array over all cells, a hash of the occupied cells, or chosen by occupancy
+enum SPH_cell_storage { SPH_CELLS_DENSE, SPH_CELLS_SPARSE, SPH_CELLS_AUTO };
+
+/*
+* @brief
+* flat cell list over the search grid
+*
+* @detail
+* the particles are physically reordered by cell with a counting sort over
+* list_num, so the particles of cell (i, j) are the contiguous range
+* [begin(i, j), end(i, j)) of the particle list. Cells are numbered
+* i * max_list[1] + j. With SPH_ORDER_ROWS they are also stored in that order,
+* so the three cells (i, j - 1), (i, j), (i, j + 1) are one contiguous range.
+* SPH_ORDER_MORTON and SPH_ORDER_HILBERT store tiles of SPH_CELL_TILE x
+* SPH_CELL_TILE cells along a space filling curve instead, with the cells of
+* a tile in row order. Cells close in space are then also close in memory in
+* both directions, which shortens the reuse distance of the neighbour loops on
+* large grids, while a column of three cells is still contiguous unless it
+* crosses a tile. The order is fixed when the grid is initialised, and every
+* build sorts the particles into it.
+*
+* After the first build no memory is allocated unless the number of particles
+* grows. A cell list may also cover only a range of the particle list, the
+* particles outside it keep their place.
+*
+* The dense storage keeps the range of every cell of the grid, so its memory
+* and the prefix sum of every build grow with the bounding box. The sparse
+* storage only keeps the occupied cells, in the same layout order, and finds
+* them through an open addressing hash of cell_id, so begin and end stay O(1)
+* and a build costs O(N + K log K) for N particles in K occupied cells,
+* independent of the size of the grid. An empty cell is the empty range
+* [0, 0), so column_ranges merges the cells one by one. Both give the same
+* order of the particles. SPH_CELLS_AUTO measures the fraction of occupied
+* cells at every build and switches to the hash below sparse_occupancy, and
+* back above twice that, converting the current build in place.
+*/
+class SPH_cell_list
+{
+public:
+    // the upper limit number of grid index in two dimension
+    int max_list[2] = { 0, 0 };
+
+    // layout of the cells in the particle list
+    SPH_cell_order order = SPH_ORDER_ROWS;
+
+    // requested storage, and whether the hash is in use
+    SPH_cell_storage storage = SPH_CELLS_AUTO;
+    bool sparse = false;
+
+    // fraction of occupied cells below which SPH_CELLS_AUTO uses the hash, about where a build of either costs the same
+    double sparse_occupancy = 0.02;
+
+    // number of occupied cells at the last build
+    int occupied = 0;
+
+    // position of every cell in the layout, indexed by cell_id, only kept by the dense storage
+    std::vector<int> rank;
+
+    // index of the first particle of every cell in layout order, with one extra entry holding the end of the range
+    std::vector<int> cell_start;
+
+    // number of particles in every cell in layout order, only of the occupied cells with the sparse storage,
+    // also used as the insertion cursor while sorting
+    std::vector<int> cell_count;
+
+    // cell_id of the occupied cells in layout order, and the index of their first particle with one extra entry, sparse storage
+    std::vector<int> occupied_cell, occupied_start;
+
+    // cell_id held by every slot of the hash, -1 if free, and the index of that cell in occupied_cell
+    std::vector<int> hash_cell, hash_index;
+
+    // buffer the particles are sorted into, swapped with the particle list after every build
+    std::vector<SPH_particle> sorted;
+
+    /*
+    * @brief set the size of the grid and the layout of its cells
+    * @param[in] nx             number of cells in x
+    * @param[in] ny             number of cells in y
+    * @param[in] cell_order     layout of the cells in the particle list
+    * @param[in] cell_storage   storage of the cell ranges
+    */
+    void initialise(int nx, int ny, SPH_cell_order cell_order = SPH_ORDER_ROWS, SPH_cell_storage cell_storage = SPH_CELLS_AUTO);
+
+    /*
+    * @brief number of cells
+    */
+    int n_cells() const { return max_list[0] * max_list[1]; }
+
+    /*
+    * @brief flat index of cell (i, j)
+    */
+    int cell_id(int i, int j) const { return i * max_list[1] + j; }
+
+    /*
+    * @brief position of cell c in occupied_cell, -1 if the cell is empty
+    */
+    int find(int c) const
+    {
+        for (unsigned slot = hash_slot(c);; slot = (slot + 1) & hash_mask)
+        {
+            if (hash_cell[slot] == c)
+                return hash_index[slot];
+            if (hash_cell[slot] < 0)
+                return -1;
+        }
+    }
+
+    /*
+    * @brief index of cell (i, j) among the cells held by the storage, its layout position with the dense storage
+    *        and its position in occupied_cell with the sparse storage, -1 if it is empty there
+    */
+    int slot(int i, int j) const { return sparse ? find(cell_id(i, j)) : rank[cell_id(i, j)]; }
+
+    /*
+    * @brief number of slots, all cells with the dense storage and the occupied ones with the sparse storage
+    */
+    int n_slots() const { return sparse ? occupied : n_cells(); }
+
+    /*
+    * @brief index of the first particle in cell (i, j)
+    */
+    int begin(int i, int j) const
+    {
+        if (!sparse)
+            return cell_start[rank[cell_id(i, j)]];
+        int k = find(cell_id(i, j));
+        return k < 0 ? 0 : occupied_start[k];
+    }
+
+    /*
+    * @brief index after the last particle in cell (i, j)
+    */
+    int end(int i, int j) const
+    {
+        if (!sparse)
+            return cell_start[rank[cell_id(i, j)] + 1];
+        int k = find(cell_id(i, j));
+        return k < 0 ? 0 : occupied_start[k + 1];
+    }
+
+    /*
+    * @brief call visit(first, last) for the particles of cells (i, j_lo) to (i, j_hi), merging the cells that follow each other
+    */
+    template <class Visit>
+    void column_ranges(int i, int j_lo, int j_hi, Visit visit) const
+    {
+        if (order == SPH_ORDER_ROWS && !sparse)
+        {
+            visit(begin(i, j_lo), end(i, j_hi));
+            return;
+        }
+
+        int first = begin(i, j_lo), last = end(i, j_lo);
+        for (int j = j_lo + 1; j <= j_hi; j++)
+        {
+            if (begin(i, j) != last)
+            {
+                visit(first, last);
+                first = begin(i, j);
+            }
+            last = end(i, j);
+        }
+        visit(first, last);
+    }
+
+    /*
+    * @brief largest number of particles in one cell at the last build
+    */
+    int max_count() const;
+
+    /*
+    * @brief counting sort the particles by cell and reorder particle_list in place, O(N)
+    * @param[in] particle_list  particles with up to date list_num, reordered on return
+    * @param[in] first          index of the first particle to sort
+    * @param[in] last           index after the last particle to sort, the end of particle_list if negative
+    */
+    void build(std::vector<SPH_particle>& particle_list, int first = 0, int last = -1);
+
+    /*
+    * @brief bytes held by the cell ranges, the rank and the hash, without the sorting buffer
+    */
+    size_t memory() const;
+
+private:
+    // side of the power of 2 square of tiles the space filling curves are defined on
+    long side = 1;
+
+    // slots of the hash minus one, the number of slots being a power of 2, and the shift of the multiplicative hash
+    unsigned hash_mask = 0;
+    int hash_shift = 32;
+
+    // while sorting: the occupied cells in the order they are met, their slots in the hash,
+    // their order by layout, and the occupied cell of every particle
+    std::vector<int> met_cell, hash_slots, cell_position, particle_cell;
+
+    unsigned hash_slot(int c) const { return (unsigned(c) * 2654435761u) >> hash_shift; }
+
+    // key giving the position of cell (i, j) in the layout
+    long layout_key(int i, int j) const;
+
+    // rank, cell_start and cell_count of the dense storage
+    void allocate_dense();
+
+    // empty hash with room for cells occupied cells
+    void reset_hash(int cells);
+
+    // counting sort over all cells, or over the occupied cells found through the hash
+    void build_dense(std::vector<SPH_particle>& particle_list, int first, int last);
+    void build_sparse(std::vector<SPH_particle>& particle_list, int first, int last);
+
+    // move the ranges of the last build to the other storage
+    void to_sparse();
+    void to_dense();
+};
@@ -0,0 +1,94 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     SPH_checkpoint.h                                                *
+*  @brief    binary checkpoint and restart of SPH_main                       *
+*  Details.                                                                  *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.9                                                         *
+*  @date     2020/03/14                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include "SPH_2D.h"
+
+// layout version of the checkpoint file, increased whenever SPH_checkpoint_header or SPH_particle changes
+#define SPH_CHECKPOINT_VERSION 4
+
+/*
+* @brief
+* fixed size header at the start of a checkpoint file
+*
+* @detail
+* the header is followed, at offset particle_offset, by n_particles SPH_particle
+* copied byte for byte, so a checkpoint can only be read by a build with the same
+* SPH_particle layout. particle_size and version are checked on restart.
+*/
+struct SPH_checkpoint_header
+{
+    char magic[8];
+    int32_t version;
+    int32_t particle_size;
+    uint64_t particle_offset;
+    uint64_t n_particles;
+
+    // progress of the run
+    double time;
+    int32_t iteration;
+
+    // kernel selection
+    int32_t kernel;
+    int32_t tabulate_kernel;
+
+    // time stepping
+    double delta_t, dt_cfl, dt_f, dt_a, t_max;
+
+    // step within the cycle of the individual time steps, the levels are kept by the particles
+    int32_t sub_step;
+
+    // resolution and grid, min_x and max_x include the boundary layer added by initialise_grid
+    double h, h_fac, dx;
+    double min_x[2], max_x[2], inner_min_x[2], inner_max_x[2];
+    int32_t max_list[2];
+};
+
+/*
+* @brief write the full state of domain to filename through a memory mapping
+*
+* @detail
+* the file is written as filename.tmp and renamed over filename once complete, so a
+* run that dies while checkpointing still has the previous checkpoint
+*
+* @param[in] filename       checkpoint file
+* @param[in] domain         simulation to save
+* @param[in] time           simulated time reached
+* @param[in] iteration      number of steps taken
+*
+* @return 0 on success, 1 if the file could not be written
+*/
+int write_checkpoint(const char* filename, const SPH_main& domain, double time, int iteration);
+
+/*
+* @brief restore domain from a checkpoint written by write_checkpoint
+*
+* @detail
+* replaces the particles, time stepping and grid of domain, set_values and
+* initialise_grid must not be called afterwards. The cell list is set up for the
+* saved grid, and Verlet lists are rebuilt by the next allocate_to_grid.
+*
+* @param[in] filename       checkpoint file
+* @param[in,out] domain     simulation to restore
+* @param[out] time          simulated time reached
+* @param[out] iteration     number of steps taken
+*
+* @return 0 on success, 1 if the file is missing or was written by an incompatible build
+*/
+int read_checkpoint(const char* filename, SPH_main& domain, double& time, int& iteration);
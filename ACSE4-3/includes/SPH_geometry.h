@@ -0,0 +1,125 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     SPH_geometry.h                                                  *
+*  @brief    initial particles described by boxes and polygons               *
+*  Details.                                                                  *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.18                                                        *
+*  @date     2020/03/20                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#pragma once
+#include <vector>
+
+class SPH_particle;
+class SPH_main;
+
+// what a shape makes of the lattice points it covers
+enum SPH_material
+{
+    SPH_EMPTY,
+    SPH_FLUID,
+    SPH_BOUNDARY
+};
+
+/*
+* @brief
+* a box or polygon of one material
+*
+* @detail
+* a shape covers the points strictly inside it. With layers > 0 it covers the
+* points outside it within layers * dx instead, a wall of that many particles
+* around it; the wall of a box has square corners, the wall of a polygon round ones.
+*/
+struct SPH_shape
+{
+    SPH_material material = SPH_FLUID;
+
+    // whether the shape is the box lower to upper, otherwise the polygon through the vertices
+    bool box = true;
+
+    // corners of the box, or bounding box of the polygon
+    double lower[2], upper[2];
+
+    // vertices of the polygon in order, x0 y0 x1 y1 ...
+    std::vector<double> vertices;
+
+    // number of particle layers of the wall around the shape, 0 to fill it
+    int layers = 0;
+
+    /*
+    * @brief whether the shape covers a point
+    * @param[in] x              position of the point
+    * @param[in] dx             particle spacing, the thickness of one layer
+    */
+    bool covers(const double* x, double dx) const;
+};
+
+/*
+* @brief
+* declarative initial condition
+*
+* @detail
+* the particles sit on the lattice of spacing dx that place_points walks, and
+* every point takes the material of the last shape covering it, so the shapes
+* are combined in the order they are given: a fluid shape adds to the union of
+* the fluid, an empty shape cuts out of everything before it. rasterise first
+* classifies every point of the lattice in parallel, counting the particles of
+* every column, then writes each column at its offset, so the particle list is
+* allocated once and has the same order as walking the lattice column by column.
+*
+* A geometry file holds one statement per line, # starts a comment:
+*     domain x0 y0 x1 y1                          region of the fluid, inner_min_x and inner_max_x
+*     fluid|boundary|empty box x0 y0 x1 y1 [layers n]
+*     fluid|boundary|empty polygon n x0 y0 ... x(n-1) y(n-1) [layers n]
+*/
+class SPH_geometry
+{
+public:
+    // region of the fluid, the walls of the tank lie outside it
+    double domain_min[2] = { 0, 0 }, domain_max[2] = { 20, 10 };
+
+    // shapes in the order they are applied
+    std::vector<SPH_shape> shapes;
+
+    /*
+    * @brief the dam break placed by the original place_points, in a tank from (0, 0) to (20, 10)
+    * @param[in] layers         number of particle layers of the walls
+    */
+    static SPH_geometry dam_break(int layers);
+
+    /*
+    * @brief read the statements of a geometry file, replacing the domain and shapes
+    * @param[in] filename       text file
+    * @return 0 on success, 1 if the file could not be read or a statement is malformed
+    */
+    int read(const char* filename);
+
+    /*
+    * @brief set the region of the simulation, to be called after set_values and before initialise_grid
+    * @param[in] domain         simulation whose inner_min_x, inner_max_x, min_x and max_x are set to the domain
+    */
+    void apply_domain(SPH_main& domain) const;
+
+    /*
+    * @brief append a particle for every point of the lattice from min to max covered by a fluid or boundary shape
+    * @param[out] particle_list     list the particles are appended to, with their index as id
+    * @param[in] min                lower corner of the lattice
+    * @param[in] max                upper corner of the lattice
+    * @param[in] dx                 particle spacing
+    * @param[in] grid_min           lower corner of the cell grid, for calc_index
+    * @param[in] h                  smoothing length, for calc_index
+    * @param[in] num_threads        number of OpenMP threads
+    * @return number of particles appended
+    */
+    long rasterise(std::vector<SPH_particle>& particle_list, const double* min, const double* max, double dx,
+        const double* grid_min, double h, int num_threads = 1) const;
+};
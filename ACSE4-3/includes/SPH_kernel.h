@@ -0,0 +1,214 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     SPH_kernel.h                                                    *
+*  @brief    smoothing kernel policies                                       *
+*  Details.                                                                  *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.8                                                         *
+*  @date     2020/03/13                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#pragma once
+
+#ifndef PI
+#define PI 3.1415926
+#endif
+
+/*
+* @brief
+* smoothing kernel policies
+*
+* @detail
+* every kernel has support 2h, the size of a grid cell, and is written in terms of q = r / h as
+*     W(r)  = norm / h^2 * w(q)
+*     dW(r) = norm / h^3 * dw(q)
+* in two dimensions, and with norm3 / h^3 and norm3 / h^4 in three, see kernel_norm.
+* norm is a compile time constant and w, dw are branch free polynomials, so a pair loop that is
+* instantiated for one kernel can inline and vectorise them. w_dw evaluates both at once for the
+* loops that need the value and the gradient.
+*/
+
+// cubic spline of Monaghan and Lattanzio
+struct SPH_cubic_spline
+{
+    static constexpr double norm = 10 / 7.0 / PI;
+    static constexpr double norm3 = 1 / PI;
+
+    static constexpr double w(double q)
+    {
+        double a = q < 2 ? 2 - q : 0;
+        double b = q < 1 ? 1 - q : 0;
+        return 0.25 * a * a * a - b * b * b;
+    }
+
+    static constexpr double dw(double q)
+    {
+        double a = q < 2 ? 2 - q : 0;
+        double b = q < 1 ? 1 - q : 0;
+        return -0.75 * a * a + 3 * b * b;
+    }
+
+    static constexpr void w_dw(double q, double& value, double& gradient)
+    {
+        double a = q < 2 ? 2 - q : 0;
+        double b = q < 1 ? 1 - q : 0;
+        value = 0.25 * a * a * a - b * b * b;
+        gradient = -0.75 * a * a + 3 * b * b;
+    }
+};
+
+// Wendland C2, the cheapest of the three with a single polynomial piece
+struct SPH_wendland_c2
+{
+    static constexpr double norm = 7 / 4.0 / PI;
+    static constexpr double norm3 = 21 / 16.0 / PI;
+
+    static constexpr double w(double q)
+    {
+        double a = q < 2 ? 1 - 0.5 * q : 0;
+        double a2 = a * a;
+        return a2 * a2 * (2 * q + 1);
+    }
+
+    static constexpr double dw(double q)
+    {
+        double a = q < 2 ? 1 - 0.5 * q : 0;
+        return -5 * q * a * a * a;
+    }
+
+    static constexpr void w_dw(double q, double& value, double& gradient)
+    {
+        double a = q < 2 ? 1 - 0.5 * q : 0;
+        double a3 = a * a * a;
+        value = a3 * a * (2 * q + 1);
+        gradient = -5 * q * a3;
+    }
+};
+
+// quintic spline of Morris, scaled from support 3h to 2h, s = 1.5 q
+struct SPH_quintic_spline
+{
+    static constexpr double norm = 7 / 478.0 / PI * 1.5 * 1.5;
+    static constexpr double norm3 = 1 / 120.0 / PI * 1.5 * 1.5 * 1.5;
+
+    static constexpr double w(double q)
+    {
+        double s = 1.5 * q;
+        double a = s < 3 ? 3 - s : 0, b = s < 2 ? 2 - s : 0, c = s < 1 ? 1 - s : 0;
+        double a2 = a * a, b2 = b * b, c2 = c * c;
+        return a2 * a2 * a - 6 * b2 * b2 * b + 15 * c2 * c2 * c;
+    }
+
+    static constexpr double dw(double q)
+    {
+        double s = 1.5 * q;
+        double a = s < 3 ? 3 - s : 0, b = s < 2 ? 2 - s : 0, c = s < 1 ? 1 - s : 0;
+        double a2 = a * a, b2 = b * b, c2 = c * c;
+        return -7.5 * (a2 * a2 - 6 * b2 * b2 + 15 * c2 * c2);
+    }
+
+    static constexpr void w_dw(double q, double& value, double& gradient)
+    {
+        double s = 1.5 * q;
+        double a = s < 3 ? 3 - s : 0, b = s < 2 ? 2 - s : 0, c = s < 1 ? 1 - s : 0;
+        double a4 = a * a * a * a, b4 = b * b * b * b, c4 = c * c * c * c;
+        value = a4 * a - 6 * b4 * b + 15 * c4 * c;
+        gradient = -7.5 * (a4 - 6 * b4 + 15 * c4);
+    }
+};
+
+// values and gradients of Kernel at points equally spaced over [0, 2], computed at compile time
+template <class Kernel, int points>
+struct SPH_kernel_table
+{
+    // one extra zero entry, read with weight zero for q >= 2
+    double w[points + 1], dw[points + 1];
+
+    constexpr SPH_kernel_table() : w(), dw()
+    {
+        for (int i = 0; i < points; i++)
+        {
+            w[i] = Kernel::w(i * 2.0 / (points - 1));
+            dw[i] = Kernel::dw(i * 2.0 / (points - 1));
+        }
+    }
+};
+
+/*
+* @brief
+* kernel interpolated linearly from a table of Kernel
+*
+* @detail
+* trades the polynomial for two loads and a multiply-add, which pays off for the quintic spline
+*/
+template <class Kernel, int points = 1025>
+struct SPH_tabulated
+{
+    static constexpr double norm = Kernel::norm;
+    static constexpr double norm3 = Kernel::norm3;
+    static constexpr double inv_step = (points - 1) / 2.0;
+    static constexpr SPH_kernel_table<Kernel, points> values{};
+
+    static double w(double q)
+    {
+        double t = q < 2 ? q * inv_step : points - 1;
+        int i = int(t);
+        return values.w[i] + (t - i) * (values.w[i + 1] - values.w[i]);
+    }
+
+    static double dw(double q)
+    {
+        double t = q < 2 ? q * inv_step : points - 1;
+        int i = int(t);
+        return values.dw[i] + (t - i) * (values.dw[i + 1] - values.dw[i]);
+    }
+
+    static void w_dw(double q, double& value, double& gradient)
+    {
+        double t = q < 2 ? q * inv_step : points - 1;
+        int i = int(t);
+        double frac = t - i;
+        value = values.w[i] + frac * (values.w[i + 1] - values.w[i]);
+        gradient = values.dw[i] + frac * (values.dw[i + 1] - values.dw[i]);
+    }
+};
+
+// normalisation of Kernel in Dim dimensions, W(r) = kernel_norm / h^Dim * w(q)
+template <class Kernel, int Dim>
+constexpr double kernel_norm()
+{
+    static_assert(Dim == 2 || Dim == 3, "kernels are normalised in two and three dimensions");
+    return Dim == 2 ? Kernel::norm : Kernel::norm3;
+}
+
+// kernel selected at run time through SPH_main::kernel
+enum SPH_kernel_type { SPH_KERNEL_CUBIC, SPH_KERNEL_WENDLAND_C2, SPH_KERNEL_QUINTIC };
+
+/*
+* @brief call visit with a default constructed policy of the selected kernel
+*
+* @detail
+* used once per sweep, so the loop inside visit is instantiated for every kernel and the
+* selection costs one switch per sweep rather than one per pair
+*/
+template <class Visitor>
+auto visit_kernel(SPH_kernel_type type, bool tabulated, Visitor&& visit)
+{
+    switch (type)
+    {
+    case SPH_KERNEL_WENDLAND_C2:
+        return tabulated ? visit(SPH_tabulated<SPH_wendland_c2>()) : visit(SPH_wendland_c2());
+    case SPH_KERNEL_QUINTIC:
+        return tabulated ? visit(SPH_tabulated<SPH_quintic_spline>()) : visit(SPH_quintic_spline());
+    default:
+        return tabulated ? visit(SPH_tabulated<SPH_cubic_spline>()) : visit(SPH_cubic_spline());
+    }
+}
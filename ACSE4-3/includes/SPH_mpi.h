@@ -0,0 +1,125 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     SPH_mpi.h                                                       *
+*  @brief    MPI domain decomposition of SPH_main                            *
+*  Details.                                                                  *
+*  Only compiled with -DSPH_USE_MPI (and CXX = mpicxx).                      *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.6                                                         *
+*  @date     2020/03/12                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#pragma once
+#ifdef SPH_USE_MPI
+#include <mpi.h>
+#include <vector>
+#include "SPH_2D.h"
+
+/*
+* @brief
+* distributed SPH_main
+*
+* @detail
+* every cell of the search grid is owned by one process, given by cell_owner.
+* The ownership is either slabs of cell columns along x or a recursive
+* bisection of the grid, both balanced on the global particle count per cell.
+* Each step the particles that left the local cells migrate to their new
+* owner, and the particles in cells next to another process are sent to it as
+* ghost particles. Cells have size 2h, so one layer of cells holds every
+* particle within 2h of the partition boundary. Ghosts take part in the force
+* loop and smoothing and are dropped after the step.
+*/
+class SPH_mpi_domain
+{
+public:
+    // rank of this process and number of processes
+    int id, p;
+
+    // the local part of the simulation
+    SPH_main* domain;
+
+    // process owning every cell, indexed like SPH_cell_list::cell_id
+    vector<int> cell_owner;
+
+    // datatype of the fields of SPH_particle that are exchanged
+    static MPI_Datatype MPI_Particle;
+
+    /*
+    * @brief set up the decomposition of a domain whose grid has been initialised
+    * @param[in] main_domain    local simulation, gets time_step.reduce_min set to global_min
+    */
+    SPH_mpi_domain(SPH_main* main_domain);
+
+    ~SPH_mpi_domain();
+
+    /*
+    * @brief build MPI_Particle from the fields needed to continue a particle on another process
+    */
+    static void buildMPIType();
+
+    /*
+    * @brief minimum of value over all processes
+    */
+    static double global_min(double value);
+
+    /*
+    * @brief sums of values over all processes, in place
+    */
+    static void global_sum(double* values, int n);
+
+    /*
+    * @brief maxima of values over all processes, in place
+    */
+    static void global_max(double* values, int n);
+
+    /*
+    * @brief split the grid between the processes so that every process owns about the same number of particles
+    * @param[in] bisection      recursive bisection of the grid if true, slabs along x otherwise
+    */
+    void partition(bool bisection = false);
+
+    /*
+    * @brief send every local particle to the process owning its cell
+    */
+    void migrate();
+
+    /*
+    * @brief receive copies of the particles in the cells next to the local cells, marked as ghost
+    */
+    void exchange_halo();
+
+    /*
+    * @brief drop the ghost particles
+    */
+    void remove_ghosts();
+
+    /*
+    * @brief advance the local particles by one time step
+    * @param[in] smooth              whether it needs to smooth density for this update
+    * @param[in] predictor_corrector whether to use the predictor corrector scheme instead of forward euler
+    * @param[in] stencil             whether it applies stencil finding neighbour algorithm
+    */
+    void step(bool smooth, bool predictor_corrector = false, bool stencil = false);
+
+    /*
+    * @brief total number of particles owned by all processes
+    */
+    long global_size();
+
+private:
+    // assign the cells of box [ci0, ci1) x [cj0, cj1) to processes [r0, r1) by recursive bisection
+    void bisect(int ci0, int ci1, int cj0, int cj1, int r0, int r1, const vector<long>& count, bool along_x_only);
+
+    // send the particles in send[r] to process r and return the received particles
+    void exchange(vector<vector<SPH_particle>>& send, vector<SPH_particle>& received);
+};
+
+#endif
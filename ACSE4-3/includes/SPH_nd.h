@@ -0,0 +1,200 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     SPH_nd.h                                                        *
+*  @brief    SPH solver templated on the number of dimensions                *
+*  Details.                                                                  *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.20                                                        *
+*  @date     2020/03/22                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#pragma once
+#include <vector>
+#include "SPH_2D.h"
+
+/*
+* @brief
+* SPH solver in Dim = 2 or 3 dimensions
+*
+* @detail
+* the same physics as SPH_main: Tait equation of state, the pair terms of
+* update_a_D, gravity along the last axis, the walls of the tank as boundary
+* particles that only change their density, and the forward Euler and predictor
+* corrector schemes with the particles bounced off the inner box. Every loop
+* over the axes runs to the constant Dim, so it is unrolled in both instances.
+*
+* The particles are kept as structure of arrays, boundary particles first, and
+* sorted by cell with a counting sort every step. Cells are 2h wide and numbered
+* in row order with the last axis fastest, so the three cells along the last
+* axis around a cell are one contiguous range and the 3^Dim stencil is read as
+* 3^(Dim - 1) ranges: 3 in 2D, 9 in 3D. Every particle visits the whole stencil
+* and writes only its own accumulators, so the force sweep needs no colouring
+* and is one OpenMP loop with min reductions of the time step limits, like
+* compute_forces_batched. The boundary particles are sorted once, when they are
+* placed.
+*
+* Instantiated for 2 and 3 in SPH_nd.cpp.
+*/
+template <int Dim>
+class SPH_solver
+{
+public:
+    static_assert(Dim == 2 || Dim == 3, "SPH_solver is instantiated in two and three dimensions");
+
+    // smoothing length, h = h_fac * dx
+    double h, h_fac;
+
+    // initial distance between particles
+    double dx;
+
+    // time step and end time
+    double delta_t, t_max;
+
+    // region of the fluid, the boundary particles lie outside it
+    double inner_min_x[Dim], inner_max_x[Dim];
+
+    // region of the grid, the fluid region enlarged by 3h
+    double min_x[Dim], max_x[Dim];
+
+    // number of cells along every axis
+    int max_list[Dim];
+
+    // number of OpenMP threads
+    int num_threads = 1;
+
+    // smoothing kernel, and whether it is interpolated from a table
+    SPH_kernel_type kernel = SPH_KERNEL_CUBIC;
+    bool tabulate_kernel = false;
+
+    // adaptive time step, the limits are taken in every force sweep when adaptive
+    SPH_time_step time_step;
+
+    // position, velocity and acceleration, one array per axis
+    std::vector<double> x[Dim], v[Dim], a[Dim];
+
+    // density, pressure and differentiation of density to time
+    std::vector<double> rho, P, D;
+
+    // state at the start of the step, only allocated by predictor_corrector
+    std::vector<double> prev_x[Dim], prev_v[Dim], prev_rho;
+
+    // number given when the particle is placed, kept while the particles are reordered
+    std::vector<int> id;
+
+    // number of boundary particles, stored in front of the fluid particles
+    int n_boundary = 0;
+
+    // pairs examined and pairs within 2h of the last force sweep
+    long candidates = 0, pairs = 0;
+
+    // number of particles
+    size_t size() const { return rho.size(); }
+
+    /*
+    * @brief set the resolution and a fluid region from lower to upper
+    * @param[in] h_factor       h = h_factor * DX
+    * @param[in] DX             initial distance between particles
+    * @param[in] T_MAX          end time
+    * @param[in] lower          lower corner of the fluid region
+    * @param[in] upper          upper corner of the fluid region
+    */
+    void set_values(double h_factor, double DX, double T_MAX, const double* lower, const double* upper);
+
+    /*
+    * @brief enlarge the region by 3h for the walls and size the cell grid
+    */
+    void initialise_grid();
+
+    /*
+    * @brief add one particle, boundary particles may only be added before the first fluid particle
+    * @param[in] position       position of the particle
+    * @param[in] boundary       whether it is a boundary particle
+    * @return 0 on success, 1 if a boundary particle follows a fluid particle or the particle is outside the grid
+    */
+    int add_particle(const double* position, bool boundary);
+
+    /*
+    * @brief fill the grid with the walls and a block of fluid, the dam break of place_points in Dim dimensions
+    * @param[in] fluid_lower    lower corner of the fluid block
+    * @param[in] fluid_upper    upper corner of the fluid block
+    * @return number of particles placed
+    */
+    long place_points(const double* fluid_lower, const double* fluid_upper);
+
+    /*
+    * @brief sort the fluid particles by cell, the boundary particles the first time only
+    */
+    void allocate_to_grid();
+
+    /*
+    * @brief zero based index of the cell of a position along every axis
+    * @param[in] position       position
+    * @param[out] cell          index along every axis
+    */
+    void cell_of(const double* position, int* cell) const;
+
+    /*
+    * @brief accumulate the acceleration and density change of all particles
+    * @param[in] change_delta_t     whether the time step limits are reduced and delta_t updated
+    * @param[in] smooth             whether the density is Shepard smoothed in the same sweep
+    */
+    void compute_forces(bool change_delta_t = false, bool smooth = false);
+
+    /*
+    * @brief one forward Euler step
+    * @param[in] smooth         whether the density is smoothed
+    */
+    void forward_euler(bool smooth);
+
+    /*
+    * @brief one predictor corrector step
+    * @param[in] smooth         whether the density is smoothed
+    */
+    void predictor_corrector(bool smooth);
+
+    /*
+    * @brief sum of the kinetic energy of the fluid particles
+    */
+    double kinetic_energy() const;
+
+private:
+    // first particle of every cell of the boundary and of the fluid, with one extra entry holding the end
+    std::vector<int> boundary_start, fluid_start;
+
+    // cell, destination and insertion cursor of the counting sort, and the reordered copy of one field
+    std::vector<int> cell, order, cursor;
+    std::vector<double> sorted;
+    std::vector<int> sorted_id;
+
+    // Shepard sums of the fused density smoothing
+    std::vector<double> w_sum, w_rho;
+
+    // whether the boundary particles have been sorted
+    bool boundary_binned = false;
+
+    // number of cells
+    int n_cells() const;
+
+    // linear index of the cell of particle i
+    int linear_cell(int i) const;
+
+    // counting sort of the particles first to last by cell into start
+    void sort_range(int first, int last, std::vector<int>& start);
+
+    template <class Kernel, bool smooth, bool fluid>
+    void neighbour_iterate(int i, double& cfl, long& found, long& examined);
+
+    // update the density and pressure of particle i
+    void update_P(int i) { P[i] = rho0 * C0 * C0 / gama * (pow(rho[i] / rho0, gama) - 1); }
+};
+
+extern template class SPH_solver<2>;
+extern template class SPH_solver<3>;
@@ -0,0 +1,185 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     SPH_scheduler.h                                                 *
+*  @brief    work stealing scheduler and task graph                          *
+*  Details.                                                                  *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.22                                                        *
+*  @date     2020/03/23                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+* @brief
+* work stealing over a list of tasks whose cost is estimated in advance
+*
+* @detail
+* plan splits the tasks, in their order, into one contiguous range per worker
+* of about equal estimated cost, so a good estimate needs no stealing at all
+* and the tasks of a worker stay neighbours in space. Every worker takes the
+* tasks of its own range from the front. A worker whose range is empty steals
+* the back half of the largest range it finds and continues with that, so a
+* worker that was given too much loses its last tasks to the others instead of
+* holding up the step.
+*
+* A range is a single 64 bit word holding its front and back, changed only by
+* compare and swap, so taking and stealing need no lock and every task is run
+* exactly once. work is called by every thread of an OpenMP parallel region,
+* which keeps the reductions of the region.
+*/
+class SPH_work_stealing
+{
+public:
+    // number of steals in the last run
+    std::atomic<long> steals{ 0 };
+
+    /*
+    * @brief split tasks 0 to cost.size() - 1 between the workers by their estimated cost
+    * @param[in] cost           estimated cost of every task, not negative
+    * @param[in] n_workers      number of workers that will call work
+    */
+    void plan(const std::vector<double>& cost, int n_workers);
+
+    /*
+    * @brief run tasks until none is left, to be called once by every worker
+    * @param[in] worker         number of the calling worker, 0 to n_workers - 1
+    * @param[in] body           called with the number of every task run by this worker
+    */
+    template <class Body>
+    void work(int worker, Body body)
+    {
+        int task;
+        for (;;)
+        {
+            while (take(worker, task))
+                body(task);
+            if (!steal(worker))
+                return;
+        }
+    }
+
+    /*
+    * @brief number of the calling thread within the OpenMP parallel region, 0 without OpenMP
+    */
+    static int worker_id()
+    {
+#ifdef _OPENMP
+        return omp_get_thread_num();
+#else
+        return 0;
+#endif
+    }
+
+private:
+    // the range of one worker, alone in its cache line
+    struct alignas(64) task_range
+    {
+        std::atomic<uint64_t> word{ 0 };
+    };
+
+    std::unique_ptr<task_range[]> ranges;
+    int n_ranges = 0;
+
+    static uint64_t pack(uint32_t front, uint32_t back) { return uint64_t(front) << 32 | back; }
+    static uint32_t front(uint64_t word) { return uint32_t(word >> 32); }
+    static uint32_t back(uint64_t word) { return uint32_t(word); }
+
+    // take the first task of the range of worker, false if it is empty
+    bool take(int worker, int& task);
+
+    // move the back half of the largest range of another worker to the range of worker, false if all are empty
+    bool steal(int worker);
+};
+
+/*
+* @brief
+* graph of tasks that each run once all the tasks they depend on have finished
+*
+* @detail
+* the graph is described once per run with clear and depend, and prepare
+* counts the unfinished dependencies of every task. Tasks become ready in a
+* queue of one slot per task, filled in the order they become ready, so the
+* tasks ready at the start run first and the rest follow as a wavefront. A
+* worker that finishes a task releases its successors, so there is no
+* barrier between the tasks except the dependencies themselves. work is
+* called by every thread of an OpenMP parallel region, and the threads that
+* find no ready task wait for one without taking a lock.
+*/
+class SPH_task_graph
+{
+public:
+    /*
+    * @brief start a new graph of tasks 0 to n_tasks - 1 without dependencies
+    * @param[in] n_tasks        number of tasks
+    */
+    void clear(int n_tasks);
+
+    /*
+    * @brief let task wait for before, to be called between clear and prepare
+    * @param[in] task           task that waits
+    * @param[in] before         task that has to finish first
+    */
+    void depend(int task, int before);
+
+    /*
+    * @brief count the dependencies and queue the tasks without any, to be called once before work
+    */
+    void prepare();
+
+    /*
+    * @brief run tasks until all are taken, to be called once by every worker
+    * @param[in] body           called with the number of every task run by this worker
+    */
+    template <class Body>
+    void work(Body body)
+    {
+        int task;
+        while (next(task))
+        {
+            body(task);
+            finish(task);
+        }
+    }
+
+private:
+    int n_tasks = 0;
+
+    // the dependencies as pairs of task and the task it waits for
+    std::vector<int> edge_task, edge_before;
+
+    // tasks waiting for every task, those of task t starting at successor_start[t]
+    std::vector<int> successor_start, successors;
+
+    // unfinished dependencies of every task
+    std::unique_ptr<std::atomic<int>[]> pending;
+
+    // ready tasks in the order they became ready, -1 in a slot not written yet
+    std::unique_ptr<std::atomic<int>[]> queue;
+
+    // next slot to take and next slot to fill, each alone in its cache line
+    alignas(64) std::atomic<int> head{ 0 };
+    alignas(64) std::atomic<int> tail{ 0 };
+
+    // take the next ready task, waiting until one is ready, false once all tasks are taken
+    bool next(int& task);
+
+    // release the tasks waiting for task
+    void finish(int task);
+};
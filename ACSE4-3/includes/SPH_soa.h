@@ -0,0 +1,105 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     SPH_soa.h                                                       *
+*  @brief    structure of arrays storage of the hot particle fields          *
+*  Details.                                                                  *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.2                                                         *
+*  @date     2020/03/05                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// number of candidate neighbours processed together by the batched pair kernel
+#define SPH_BATCH 8
+
+class SPH_particle;
+
+/*
+* @brief
+* structure of arrays copy of the particle fields used in the pair interactions
+*
+* @detail
+* every field needed by the force loop lives in its own contiguous array, so
+* that the batched kernel loads only useful data and the compiler can
+* vectorise over candidate neighbours. The arrays are indexed in the same
+* order as SPH_main::particle_list and padded with SPH_BATCH far away
+* particles, so a batch may always be loaded in full.
+*/
+class SPH_soa
+{
+public:
+    // position
+    std::vector<double> x, y;
+
+    // velocity
+    std::vector<double> vx, vy;
+
+    // density and pressure
+    std::vector<double> rho, P;
+
+    // P / rho^2 and 1 / rho^2, computed once per particle instead of once per pair
+    std::vector<double> P_rho2, inv_rho2;
+
+    // accumulated acceleration and differentiation of density to time
+    std::vector<double> ax, ay, D;
+
+    // sums of W and W / rho of the density smoothing done within the force sweep
+    std::vector<double> w_sum, w_rho;
+
+    // number of particles stored, without the padding
+    size_t n = 0;
+
+    /*
+    * @brief number of particles stored
+    */
+    size_t size() const { return n; }
+
+    /*
+    * @brief resize all the arrays and reset the padding, only reallocates when the particle number grows
+    * @param[in] n_particles     number of particles
+    */
+    void resize(size_t n_particles);
+
+    /*
+    * @brief copy the hot fields from the particle list and reset the accumulators
+    * @param[in] particle_list   particles to copy from
+    * @param[in] gravity         initial vertical acceleration of the fluid particles
+    * @param[in] num_threads     number of OpenMP threads sharing the copy
+    */
+    void gather(const std::vector<SPH_particle>& particle_list, double gravity, int num_threads = 1);
+
+    /*
+    * @brief copy the accumulated acceleration and density change back to the particle list
+    * @param[in] particle_list   particles to copy to
+    * @param[in] num_threads     number of OpenMP threads sharing the copy
+    */
+    void scatter(std::vector<SPH_particle>& particle_list, int num_threads = 1) const;
+
+    /*
+    * @brief gather particles first to last - 1 only, the arrays already being resized
+    * @param[in] particle_list   particles to copy from
+    * @param[in] gravity         initial vertical acceleration of the fluid particles
+    * @param[in] first          index of the first particle
+    * @param[in] last           index after the last particle
+    */
+    void gather(const std::vector<SPH_particle>& particle_list, double gravity, int first, int last);
+
+    /*
+    * @brief scatter particles first to last - 1 only
+    * @param[in] particle_list   particles to copy to
+    * @param[in] first          index of the first particle
+    * @param[in] last           index after the last particle
+    */
+    void scatter(std::vector<SPH_particle>& particle_list, int first, int last) const;
+};
@@ -0,0 +1,112 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     SPH_sweep.h                                                     *
+*  @brief    independent simulations run concurrently for parameter sweeps   *
+*  Details.                                                                  *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.17                                                        *
+*  @date     2020/03/20                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#pragma once
+#include <string>
+#include <vector>
+
+/*
+* @brief
+* parameters of one simulation of a sweep
+*/
+struct SPH_run_config
+{
+    // name of the run, every file it writes starts with prefix
+    std::string name;
+
+    // output prefix, name + "_" unless set
+    std::string prefix;
+
+    // initial particle distance, h = h_factor * dx
+    double dx = 0.2;
+    double h_factor = 1.3;
+
+    // simulated time
+    double t_max = 1.0;
+
+    // geometry file of the initial particles, the dam break if empty
+    std::string geometry;
+
+    // predictor corrector with an adaptive time step instead of forward Euler
+    bool predictor_corrector = false;
+
+    // OpenMP threads of this simulation
+    int num_threads = 1;
+
+    // steps between two density smoothings
+    int smooth_interval = 20;
+
+    // steps between two snapshots, 0 for none
+    int snapshot_interval = 0;
+
+    // whether the time series of SPH_analytics is written to prefix + "analytics.csv"
+    bool analytics = true;
+};
+
+/*
+* @brief
+* timing summary and final state of one simulation of a sweep
+*/
+struct SPH_run_summary
+{
+    std::string name;
+
+    // 0 on success, 1 if a file could not be written
+    int status = 0;
+
+    int particles = 0;
+    int steps = 0;
+    double time = 0;
+
+    // wall clock seconds of the time loop, and per particle and step
+    double seconds = 0;
+    double ns_per_particle_step = 0;
+
+    // SPH_analytics of the last step
+    double kinetic_energy = 0, max_velocity = 0, surge_front = 0;
+};
+
+/*
+* @brief read a sweep, one run per line as "name dx h_factor t_max scheme [geometry]", scheme being fe or pc
+* @param[in] filename       text file, empty lines and lines starting with # are skipped
+* @param[out] configs       the runs, appended
+* @return 0 on success, 1 if the file could not be read or a line is malformed
+*/
+int read_sweep(const char* filename, std::vector<SPH_run_config>& configs);
+
+/*
+* @brief run one simulation in the calling thread and write its timing summary to prefix + "summary.json"
+* @param[in] config         parameters of the run
+* @return the timing summary
+*/
+SPH_run_summary run_simulation(const SPH_run_config& config);
+
+/*
+* @brief run independent simulations concurrently
+*
+* @detail
+* every simulation has its own SPH_main, so nothing is shared between them. A pool
+* of worker threads takes the next configuration from a shared counter whenever it
+* finishes one, so long runs do not hold up the short ones; with one OpenMP thread
+* per simulation the throughput grows with the number of cores, without the
+* synchronisation of a parallel force loop.
+* @param[in] configs        the runs
+* @param[in] workers        number of simulations run at the same time, at least 1
+* @return the timing summaries, in the order of configs
+*/
+std::vector<SPH_run_summary> run_sweep(const std::vector<SPH_run_config>& configs, int workers);
@@ -0,0 +1,90 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     SPH_time_step.h                                                 *
+*  @brief    adaptive time step from the CFL, force and acoustic limits      *
+*  Details.                                                                  *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.12                                                        *
+*  @date     2020/03/17                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#pragma once
+#include <cmath>
+#include "SPH_trace.h"
+
+// value of a limit that no particle has set
+#define SPH_DT_NONE 1e300
+
+/*
+* @brief
+* adaptive time step
+*
+* @detail
+* the force sweeps reduce three limits over all particles and pairs with
+* OpenMP min reductions:
+*     cfl       h / |v_i - v_j|                over the pairs within 2h
+*     force     sqrt(h / |a_i|)                over the fluid particles
+*     acoustic  h / c_i, c_i = C0 (rho_i / rho0)^((gamma - 1) / 2)
+* next combines them once per step into
+*     delta_t = min(safety * min(cfl, force, acoustic), max_growth^steps * previous delta_t)
+* for a previous delta_t taken steps times, and passes the result through reduce_min,
+* so every MPI process takes the same step.
+*/
+class SPH_time_step
+{
+public:
+    // whether delta_t is updated every step, otherwise only when a scheme asks for it
+    bool adaptive = false;
+
+    // fraction of the smallest limit used as time step
+    double safety = 0.2;
+
+    // largest factor by which delta_t may grow from one step to the next
+    double max_growth = 1.2;
+
+    // optional global minimum over all processes
+    double (*reduce_min)(double) = nullptr;
+
+    // which limit set the last time step
+    SPH_dt_limiter limiter = SPH_DT_FIXED;
+
+    /*
+    * @brief CFL limit of a pair
+    * @param[in] h              smoothing length
+    * @param[in] v2             squared relative velocity of the pair
+    */
+    static double cfl_limit(double h, double v2) { return v2 > 0 ? h / std::sqrt(v2) : SPH_DT_NONE; }
+
+    /*
+    * @brief force limit of a particle
+    * @param[in] h              smoothing length
+    * @param[in] a2             squared acceleration of the particle
+    */
+    static double force_limit(double h, double a2) { return a2 > 0 ? std::sqrt(h / std::sqrt(a2)) : SPH_DT_NONE; }
+
+    /*
+    * @brief acoustic limit of a particle, h over the speed of sound of the Tait equation with gamma = 7
+    * @param[in] h              smoothing length
+    * @param[in] c0             speed of sound at the reference density
+    * @param[in] rho_ratio      density over the reference density
+    */
+    static double acoustic_limit(double h, double c0, double rho_ratio) { return h / (c0 * rho_ratio * rho_ratio * rho_ratio); }
+
+    /*
+    * @brief time step following previous under the given limits, the same on every process
+    * @param[in] previous       time step of the last step
+    * @param[in] cfl            smallest CFL limit
+    * @param[in] force          smallest force limit
+    * @param[in] acoustic       smallest acoustic limit
+    * @param[in] steps          steps of previous since the last update, each allowed to grow by max_growth
+    */
+    double next(double previous, double cfl, double force, double acoustic, int steps = 1);
+};
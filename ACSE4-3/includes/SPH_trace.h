@@ -0,0 +1,133 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     SPH_trace.h                                                     *
+*  @brief    per step timing and counters of SPH_main                        *
+*  Details.                                                                  *
+*  Compiled out with -DSPH_NO_TRACE.                                         *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.11                                                        *
+*  @date     2020/03/16                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#pragma once
+#include <chrono>
+#include <fstream>
+#include <string>
+
+// which limit set delta_t, SPH_DT_GROWTH when it was held back by the maximum growth rate
+enum SPH_dt_limiter { SPH_DT_FIXED, SPH_DT_CFL, SPH_DT_FORCE, SPH_DT_ACOUSTIC, SPH_DT_GROWTH };
+
+// what happened in one time step
+struct SPH_step_record
+{
+    // wall clock seconds spent in every phase
+    double t_grid = 0, t_forces = 0, t_smoothing = 0, t_integration = 0;
+
+    // candidate pairs looked at by the force loop and the pairs within 2h among them
+    long candidates = 0, pairs = 0;
+
+    // largest number of particles in one cell of the grid
+    int max_per_cell = 0;
+
+    // number of times the Verlet lists were rebuilt in this step
+    int verlet_builds = 0;
+
+    SPH_dt_limiter limiter = SPH_DT_FIXED;
+};
+
+/*
+* @brief
+* per step trace of SPH_main
+*
+* @detail
+* nothing is measured until open is called, after that every step appends one row
+* to a CSV file, or one object to a JSON array if the file name ends in .json.
+* The phases are timed with SPH_phase_timer, which costs two clock reads per phase
+* and step, and the pair counts are reductions of the force loops.
+*/
+class SPH_trace
+{
+public:
+    // whether a trace file is open
+    bool enabled = false;
+
+    // step being recorded
+    SPH_step_record current;
+
+    // number of steps and simulated time so far
+    int step = 0;
+    double time = 0;
+
+    ~SPH_trace();
+
+    /*
+    * @brief start writing the trace to filename, CSV unless filename ends in .json
+    * @return 0 on success, 1 if the file could not be opened
+    */
+    int open(const std::string& filename);
+
+    /*
+    * @brief finish the file
+    */
+    void close();
+
+    /*
+    * @brief write the current step and start a new one
+    * @param[in] delta_t        time step taken
+    * @param[in] particles      number of particles
+    */
+    void end_step(double delta_t, size_t particles);
+
+private:
+    std::ofstream file;
+    bool json = false;
+
+    // number of steps written to the current file
+    int rows = 0;
+};
+
+/*
+* @brief
+* adds the wall clock time of its scope to one field of the current step
+*/
+class SPH_phase_timer
+{
+public:
+    SPH_phase_timer(SPH_trace& trace, double SPH_step_record::* field) : trace(trace), field(field)
+    {
+#ifndef SPH_NO_TRACE
+        running = trace.enabled;
+        if (running)
+            start = std::chrono::steady_clock::now();
+#endif
+    }
+
+    ~SPH_phase_timer()
+    {
+        stop();
+    }
+
+    // end the phase before the end of the scope
+    void stop()
+    {
+#ifndef SPH_NO_TRACE
+        if (running)
+            trace.current.*field += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        running = false;
+#endif
+    }
+
+private:
+    SPH_trace& trace;
+    double SPH_step_record::* field;
+    bool running = false;
+    std::chrono::steady_clock::time_point start;
+};
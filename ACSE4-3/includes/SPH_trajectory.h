@@ -0,0 +1,198 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     SPH_trajectory.h                                                *
+*  @brief    compressed single file time series of the particles             *
+*  Details.                                                                  *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.19                                                        *
+*  @date     2020/03/21                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "SPH_2D.h"
+
+// layout version of the trajectory file
+#define SPH_TRAJECTORY_VERSION 1
+
+// bits of a position below the cell, a cell of 2h is split into 2^16 steps
+#define SPH_TRAJECTORY_CELL_BITS 16
+
+/*
+* @brief
+* fixed size header at the start of a trajectory file
+*
+* @detail
+* the header is followed by the frames, each an SPH_trajectory_frame_header and
+* its bit stream, and after the last frame by the index, n_frames
+* SPH_trajectory_entry. index_offset is 0 while a writer has the file open, a
+* reader then finds the frames by walking their headers.
+*/
+struct SPH_trajectory_header
+{
+    char magic[8];
+    int32_t version;
+    int32_t keyframe_interval;
+
+    // positions are stored as integers of quantum, counted from origin
+    double origin[2];
+    double quantum;
+
+    uint64_t index_offset;
+    uint64_t n_frames;
+};
+
+struct SPH_trajectory_frame_header
+{
+    uint64_t n_particles;
+    uint64_t n_bytes;
+    double time;
+    int32_t step;
+
+    // whether the frame is encoded on its own, otherwise against the frame before it
+    int32_t keyframe;
+};
+
+// where a frame starts, and what it holds
+struct SPH_trajectory_entry
+{
+    uint64_t offset;
+    double time;
+    int32_t step;
+    int32_t keyframe;
+};
+
+/*
+* @brief
+* particles of a trajectory frame, as integers
+*
+* @detail
+* the particles are sorted by SPH_particle::id, so that the same slot holds the
+* same particle in consecutive frames even though the simulation reorders them
+* every step. q holds the position in units of quantum from the origin, whose
+* upper bits are the cell and lower SPH_TRAJECTORY_CELL_BITS the offset from the
+* cell origin; bits holds the float bit patterns of v[0], v[1], rho and P.
+*/
+struct SPH_trajectory_state
+{
+    std::vector<int> id;
+    std::vector<int64_t> q[2];
+    std::vector<uint32_t> bits[4];
+    std::vector<uint8_t> boundary;
+
+    void resize(size_t n);
+};
+
+/*
+* @brief
+* append-only writer of a trajectory file
+*
+* @detail
+* a keyframe stores the ids, the boundary flags, and the positions and fields as
+* differences to the particle before. The frames in between store them as
+* differences to the same particle in the frame before, so a particle at rest takes
+* one bit per array. The fields are differenced as the integers of their float bit
+* patterns, which is exact, so they are stored without loss as the float the VTK
+* files hold; the positions are kept to within half a quantum. Every difference is
+* written as its bit length, coded against the length of the difference before in
+* the same array, followed by its bits. Every keyframe_interval frames, and whenever
+* the set of particles changes, a keyframe is written, so any frame can be decoded
+* from the keyframe before it. Ghost particles are skipped.
+*/
+class SPH_trajectory_writer
+{
+public:
+    // frames between two keyframes
+    int keyframe_interval = 16;
+
+    ~SPH_trajectory_writer();
+
+    /*
+    * @brief start a trajectory
+    * @param[in] filename       file to write
+    * @param[in] domain         simulation, whose grid origin and h set the quantisation of the positions
+    * @param[in] append         continue the trajectory of a restarted run, whose frames are kept
+    * @return 0 on success, 1 if the file could not be opened or is no trajectory
+    */
+    int open(const std::string& filename, const SPH_main& domain, bool append = false);
+
+    /*
+    * @brief encode and append one frame
+    * @param[in] particle_list  particles, with ids unique among the non ghost ones
+    * @param[in] time           simulated time
+    * @param[in] step           number of the step
+    * @return number of bytes appended, 0 if the file is not open
+    */
+    uint64_t write_frame(const std::vector<SPH_particle>& particle_list, double time, int step);
+
+    /*
+    * @brief write the index and close the file
+    */
+    void close();
+
+    bool is_open() const { return file.is_open(); }
+
+private:
+    std::fstream file;
+    SPH_trajectory_header header;
+    std::vector<SPH_trajectory_entry> index;
+
+    // the last frame written, the reference of the next one
+    SPH_trajectory_state previous, current;
+    bool has_previous = false;
+
+    // frames since the last keyframe, including it
+    int since_keyframe = 0;
+
+    // slot of every id in current, -1 for ids not present
+    std::vector<int> slot;
+
+    std::vector<uint64_t> words;
+};
+
+/*
+* @brief
+* random access reader of a trajectory file
+*/
+class SPH_trajectory_reader
+{
+public:
+    // header of the file
+    SPH_trajectory_header header;
+
+    // every frame in the file
+    std::vector<SPH_trajectory_entry> index;
+
+    /*
+    * @brief read the header and index of a trajectory, walking the frames if it was not closed
+    * @param[in] filename       file to read
+    * @return 0 on success, 1 if the file could not be read or is no trajectory
+    */
+    int open(const std::string& filename);
+
+    /*
+    * @brief decode a frame, from the keyframe at or before it
+    * @param[in] frame          number of the frame, 0 to index.size() - 1
+    * @param[out] particle_list position, velocity, density, pressure, boundary flag and id of the particles, by id
+    * @return 0 on success, 1 if the frame does not exist or is damaged
+    */
+    int read_frame(size_t frame, std::vector<SPH_particle>& particle_list);
+
+private:
+    std::ifstream file;
+
+    // the frame in state, so that reading forward decodes one frame at a time
+    SPH_trajectory_state state;
+    long decoded = -1;
+};
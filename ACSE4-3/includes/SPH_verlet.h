@@ -0,0 +1,75 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     SPH_verlet.h                                                    *
+*  @brief    Verlet neighbour lists with a skin distance                     *
+*  Details.                                                                  *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.4                                                         *
+*  @date     2020/03/08                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#pragma once
+#include <vector>
+
+class SPH_particle;
+class SPH_cell_list;
+
+/*
+* @brief
+* per-particle neighbour lists in compressed sparse row form
+*
+* @detail
+* the neighbours of particle i are neighbours[start[i]] to neighbours[start[i + 1] - 1].
+* Every particle within 2h + skin is stored, in both directions, so a list stays
+* valid until some particle has moved further than skin / 2 since it was built.
+* Particles must not be reordered between two builds. The static boundary particles
+* at the front of the particle list only get their fluid neighbours, the pairs of two
+* boundary particles are listed once in SPH_boundary_set.
+*/
+class SPH_verlet_list
+{
+public:
+    // extra distance added to the 2h cut off
+    double skin = 0;
+
+    // first entry of every particle in neighbours, with one extra entry holding the total
+    std::vector<int> start;
+
+    // indices of the neighbours of all particles
+    std::vector<int> neighbours;
+
+    // positions of the particles when the lists were built
+    std::vector<double> x0, y0;
+
+    // number of times the lists have been built
+    int n_builds = 0;
+
+    /*
+    * @brief whether a particle has moved further than skin / 2 since the last build, or the particles changed
+    * @param[in] particle_list  current particles
+    * @param[in] num_threads    number of OpenMP threads
+    *
+    * @return true if the lists have to be built again
+    */
+    bool needs_rebuild(const std::vector<SPH_particle>& particle_list, int num_threads = 1) const;
+
+    /*
+    * @brief build the lists of all particles with cut off 2h + skin
+    * @param[in] particle_list  particles, boundary particles first, then the fluid particles sorted by cell
+    * @param[in] cells          cell list built on the fluid particles
+    * @param[in] boundary_cells cell list built on the boundary particles
+    * @param[in] n_boundary     number of boundary particles
+    * @param[in] h              smoothing length
+    * @param[in] num_threads    number of OpenMP threads
+    */
+    void build(const std::vector<SPH_particle>& particle_list, const SPH_cell_list& cells, const SPH_cell_list& boundary_cells,
+        int n_boundary, double h, int num_threads = 1);
+};
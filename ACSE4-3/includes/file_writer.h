@@ -3,5 +3,20 @@
 #include <vector>
 #include "SPH_2D.h"
 
+// point data arrays that can be selected for write_file_binary, combined with |
+enum vtk_field
+{
+  VTK_PRESSURE = 1,
+  VTK_VELOCITY = 2,
+  VTK_DENSITY = 4,
+  VTK_BOUNDARY = 8,
+  VTK_ALL_FIELDS = VTK_PRESSURE | VTK_VELOCITY | VTK_DENSITY | VTK_BOUNDARY
+};
+
 int write_file(const char* filename,
 	       std::vector<SPH_particle> *particle_list);
+
+int write_file_binary(const char* filename,
+		      std::vector<SPH_particle> *particle_list,
+		      int fields = VTK_PRESSURE | VTK_VELOCITY,
+		      bool base64 = false);
@@ -0,0 +1,109 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     snapshot_writer.h                                               *
+*  @brief    background thread writing snapshots from a bounded queue        *
+*  Details.                                                                  *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.5                                                         *
+*  @date     2020/03/10                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#pragma once
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "SPH_2D.h"
+#include "file_writer.h"
+#include "SPH_trajectory.h"
+
+/*
+* @brief
+* asynchronous snapshot output
+*
+* @detail
+* submit copies the particles into a snapshot buffer and returns, a background
+* thread writes the queued snapshots with write_file_binary. At most max_pending
+* snapshots wait in the queue, so memory stays bounded and the time stepping only
+* blocks when the writer falls more than max_pending frames behind. Buffers are
+* recycled, so no memory is allocated once max_pending + 1 buffers exist.
+* When trajectory is set the snapshots are appended to it as frames instead.
+*/
+class SPH_snapshot_writer
+{
+public:
+    /*
+    * @brief start the writer thread
+    * @param[in] max_pending     number of snapshots that may wait to be written
+    * @param[in] fields          point data arrays written, combination of vtk_field
+    */
+    SPH_snapshot_writer(int max_pending = 2, int fields = VTK_PRESSURE | VTK_VELOCITY);
+
+    /*
+    * @brief write the remaining snapshots and stop the writer thread
+    */
+    ~SPH_snapshot_writer();
+
+    /*
+    * @brief queue a copy of the particles to be written to filename, blocks while the queue is full
+    * @param[in] filename        file to write, unused with a trajectory
+    * @param[in] particle_list   particles to write
+    * @param[in] time            simulated time of the frame, for a trajectory
+    * @param[in] step            number of the step of the frame, for a trajectory
+    */
+    void submit(const string& filename, const vector<SPH_particle>& particle_list, double time = 0, int step = 0);
+
+    /*
+    * @brief block until every submitted snapshot has been written
+    */
+    void finish();
+
+    // number of snapshots written so far
+    int frames_written = 0;
+
+    // number of times submit had to wait for the writer
+    int stalls = 0;
+
+    // trajectory the frames are appended to instead of VTK files, set before the first submit
+    SPH_trajectory_writer* trajectory = nullptr;
+
+    // bytes written so far
+    uint64_t bytes_written = 0;
+
+private:
+    struct snapshot
+    {
+        string filename;
+        vector<SPH_particle> particles;
+        double time;
+        int step;
+    };
+
+    // write queued snapshots until stopped
+    void run();
+
+    int max_pending;
+    int fields;
+
+    // snapshots waiting to be written, and buffers ready to be reused
+    deque<snapshot> queue;
+    vector<vector<SPH_particle>> free_buffers;
+
+    // whether the writer thread is writing a snapshot taken from the queue
+    bool busy = false;
+    bool stop = false;
+
+    mutex lock;
+    condition_variable changed;
+    thread worker;
+};
@@ -1,17 +1,10 @@
 #include "../includes/SPH_2D.h"
 //#include <omp.h>
 
-SPH_main* SPH_particle::main_data;
-
-void SPH_particle::calc_index(void)
+void SPH_particle::calc_index(const double* min_x, double h)
 {
     for (int i = 0; i < 2; i++)
-        list_num[i] = int((x[i] - main_data->min_x[i]) / (2.0 * main_data->h));
-}
-
-SPH_main::SPH_main()
-{
-    SPH_particle::main_data = this;
+        list_num[i] = int((x[i] - min_x[i]) / (2.0 * h));
 }
 
 void SPH_main::set_values(double h_factor, double DX, double T_MAX)
@@ -27,7 +20,7 @@ void SPH_main::set_values(double h_factor, double DX, double T_MAX)
     h = dx * h_fac;
     t_max = T_MAX;
     delta_t = 0.1 * h / C0;
-    cout << h << endl;
+    verlet.skin = 0.2 * h;
 }
 
 void SPH_main::initialise_grid(void)
@@ -43,70 +36,60 @@ void SPH_main::initialise_grid(void)
     }
 
     // set dimensional size of grid matrix
-    search_grid.resize(max_list[0]);
-    for (int i = 0; i < max_list[0]; i++)
-        search_grid[i].resize(max_list[1]);
+    cells.initialise(max_list[0], max_list[1], cell_order, cell_storage);
 }
 
 void SPH_main::place_points(double* min, double* max)
 {
-    double x[2] = { min[0], min[1] };
-    SPH_particle particle;
+    // the walls fill the 3h added around the tank by initialise_grid
+    place_points(SPH_geometry::dam_break(int(3.0 * h / dx) + 2), min, max);
+}
 
-    while (x[0] <= max[0])
-    {
-        x[1] = min[1];
-        while (x[1] <= max[1])
-        {
-            // blank part
-            if (x[1] > 5 && x[1] < 10 && x[0] >= inner_min_x[0] && x[0] <= inner_max_x[0])
-            {
-                x[1] += dx;
-                continue;
-            }
+void SPH_main::place_points(const SPH_geometry& geometry, double* min, double* max)
+{
+    geometry.rasterise(particle_list, min, max, dx, min_x, h, num_threads);
 
-            // blank part
-            if (x[0] > 3 && x[0] < 20 && x[1] > 2 && x[1] < 5)
-            {
-                x[1] += dx;
-                continue;
-            }
+    // the new particles have to be sorted into the boundary and fluid sets
+    boundary.binned = false;
+}
 
-            for (int i = 0; i < 2; i++)
-                particle.x[i] = x[i];
+void SPH_main::allocate_to_grid(void)                //needs to be called each time that all the particles have their positions updated
+{
+    SPH_phase_timer timer(trace, &SPH_step_record::t_grid);
 
-            if (!(x[0] > inner_min_x[0] && x[0] < inner_max_x[0] && x[1] > inner_min_x[1] && x[1] < inner_max_x[1]))
-                // boundary particles
-                particle.boundary_status = true;
-            else
-                // fliud particles
-                particle.boundary_status = false;
+    // the steps after this sort do not check how far the particles move
+    pipeline_sorted = false;
 
-            // calculate the grid index of the particle
-            particle.calc_index();
+    if (cells.order != cell_order || cells.storage != cell_storage)
+    {
+        cells.initialise(max_list[0], max_list[1], cell_order, cell_storage);
+        boundary.binned = false;
+    }
 
-            particle_list.push_back(particle);
+    // boundary particles never move, they are only sorted again after particles were added or removed
+    if (!boundary.binned)
+    {
+        boundary.build(particle_list, max_list[0], max_list[1], h, num_threads, cell_order, cell_storage);
 
-            x[1] += dx;
-        }
-        x[0] += dx;
+        // the particles have moved in the list, so the Verlet lists no longer apply
+        verlet.x0.clear();
     }
-}
-
-void SPH_main::allocate_to_grid(void)                //needs to be called each time that all the particles have their positions updated
-{
-    for (int i = 0; i < max_list[0]; i++)
-        for (int j = 0; j < max_list[1]; j++)
-            search_grid[i][j].clear();
 
-    for (unsigned int cnt = 0; cnt < particle_list.size(); cnt++)
+    // the Verlet lists hold indices into particle_list, so the particles stay in place until the lists expire
+    if (!use_verlet || verlet.needs_rebuild(particle_list, num_threads))
     {
-        // compute the index of the particle in its grid, which will be used for stencil finding neighbour algorithm
-        particle_list[cnt].grid_index = search_grid[particle_list[cnt].list_num[0]][particle_list[cnt].list_num[1]].size();
+        // counting sort of the fluid particles by cell, which also sets grid_index used for stencil finding neighbour algorithm
+        cells.build(particle_list, boundary.n);
 
-        // reset the particles in new grid
-        search_grid[particle_list[cnt].list_num[0]][particle_list[cnt].list_num[1]].push_back(&particle_list[cnt]);
+        if (use_verlet)
+        {
+            verlet.build(particle_list, cells, boundary.cells, boundary.n, h, num_threads);
+            trace.current.verlet_builds++;
+        }
     }
+
+    if (trace.enabled)
+        trace.current.max_per_cell = cells.max_count();
 }
 
 void SPH_main::update_a_D(SPH_particle* part, SPH_particle* other_part, double dist, bool stencil)
@@ -122,23 +105,23 @@ void SPH_main::update_a_D(SPH_particle* part, SPH_particle* other_part, double d
     m_j = dx * dx * rho0;
     dW = calculate_dW(dist);
 
-    // calculate the acceleration
-    for (int k = 0; k != 2; k++)
+    // calculate the acceleration, unless it is only wanted for boundary particles
+    bool accelerate = !part->boundary_status || (stencil && !other_part->boundary_status);
+    for (int k = 0; accelerate && k != 2; k++)
     {
-        bracket_num1[k] = part->P / pow(part->rho, 2) + other_part->P / pow(other_part->rho, 2);
-        bracket_num2[k] = 1.0 / pow(part->rho, 2) + 1.0 / pow(other_part->rho, 2);
+        bracket_num1[k] = part->P / (part->rho * part->rho) + other_part->P / (other_part->rho * other_part->rho);
+        bracket_num2[k] = 1.0 / (part->rho * part->rho) + 1.0 / (other_part->rho * other_part->rho);
 
         e_ij[k] = (part->x[k] - other_part->x[k]) / dist;
 
         first_item[k] = m_j * bracket_num1[k] * dW * e_ij[k];
         second_item[k] = m_j * bracket_num2[k] * dW * (part->v[k] - other_part->v[k]) / dist;
 
+        // boundary particles never accelerate, but their fluid neighbours still feel them
         if (!part->boundary_status)
-        {
             part->a[k] += mu * second_item[k] - first_item[k];
-            if (stencil)
-                other_part->a[k] -= mu * second_item[k] - first_item[k];
-        }
+        if (stencil && !other_part->boundary_status)
+            other_part->a[k] -= mu * second_item[k] - first_item[k];
     }
 
     // calculate the density
@@ -149,27 +132,14 @@ void SPH_main::update_a_D(SPH_particle* part, SPH_particle* other_part, double d
         other_part->D += m_j * dW * dot_product;
 }
 
-void SPH_main::update_dynamical_t(SPH_particle* part, SPH_particle* other_part)
+void SPH_main::update_dynamical_t(SPH_particle* part, SPH_particle* other_part, double& cfl)
 {
-    // compute dt_cfl
-    double v_ij = sqrt(pow(part->v[0] - other_part->v[0], 2) + pow(part->v[1] - other_part->v[1], 2));
-    double tmp_cfl = h / v_ij;
-    if (tmp_cfl < dt_cfl)
-        dt_cfl = tmp_cfl;
-
-    // compute dt_f
-    double a_i = sqrt(pow(part->a[0], 2) + pow(part->a[1], 2));
-    double tmp_f = sqrt(h / a_i);
-    if (tmp_f < dt_f)
-        dt_f = tmp_f;
-
-    // compute dt_a
-    double tmp_a = h / C0 / sqrt(pow(part->rho / rho0, (gama - 1) / 2.0));
-    if (tmp_a < dt_a)
-        dt_a = tmp_a;
+    // the force and acoustic limits need the final acceleration and density, they are taken by particle_limits
+    double dvx = part->v[0] - other_part->v[0], dvy = part->v[1] - other_part->v[1];
+    cfl = min(cfl, SPH_time_step::cfl_limit(h, dvx * dvx + dvy * dvy));
 }
 
-void SPH_main::neighbour_iterate_non_stencil(SPH_particle* part, bool stencil, bool change_delta_t)
+void SPH_main::neighbour_iterate_non_stencil(SPH_particle* part, double& cfl, long& candidates, long& pairs)
 {
     SPH_particle* other_part;
 
@@ -179,40 +149,62 @@ void SPH_main::neighbour_iterate_non_stencil(SPH_particle* part, bool stencil, b
     //vector from 1st to 2nd particle
     double dn[2];
 
+    auto visit = [&](int first, int last)
+    {
+        for (int cnt = first; cnt < last; cnt++)
+        {
+            other_part = &particle_list[cnt];
+
+            //stops particle interacting with itself
+            if (part != other_part)
+            {
+                candidates++;
+
+                //Calculates the distance between potential neighbours
+                for (int n = 0; n < 2; n++)
+                    dn[n] = part->x[n] - other_part->x[n];
+
+                dist = sqrt(dn[0] * dn[0] + dn[1] * dn[1]);
+
+                //only particle within 2h
+                if (dist < 2. * h)
+                {
+                    pairs++;
+                    update_a_D(part, other_part, dist);
+                    update_dynamical_t(part, other_part, cfl);
+                }
+            }
+        }
+    };
+
     for (int i = part->list_num[0] - 1; i <= part->list_num[0] + 1; i++)
         if (i >= 0 && i < max_list[0])
             for (int j = part->list_num[1] - 1; j <= part->list_num[1] + 1; j++)
                 if (j >= 0 && j < max_list[1])
                 {
-                    for (unsigned int cnt = 0; cnt < search_grid[i][j].size(); cnt++)
-                    {
-                        other_part = search_grid[i][j][cnt];
-
-                        //stops particle interacting with itself
-                        if (part != other_part)
-                        {
-                            //Calculates the distance between potential neighbours
-                            for (int n = 0; n < 2; n++)
-                                dn[n] = part->x[n] - other_part->x[n];
+                    visit(cells.begin(i, j), cells.end(i, j));
 
-                            dist = sqrt(dn[0] * dn[0] + dn[1] * dn[1]);
-
-                            //only particle within 2h
-                            if (dist < 2. * h)
-                            {
-                                update_a_D(part, other_part, dist);
-                                update_dynamical_t(part, other_part);
-                            }
-                        }
-                    }
+                    // two boundary particles change neither acceleration nor density of each other
+                    if (!part->boundary_status)
+                        visit(boundary.cells.begin(i, j), boundary.cells.end(i, j));
                 }
-    // if it is predictor corrector scheme, it needs to update time stepping
-    if (change_delta_t)
-        delta_t = min(min(dt_cfl, dt_f), dt_a);
 }
 
 // iterates over all particles within 2h of part - can be made more efficient using a stencil and realising that all interactions are symmetric
-void SPH_main::neighbour_iterate(SPH_particle* part, bool stencil, bool change_delta_t)
+void SPH_main::neighbour_iterate(SPH_particle* part, bool stencil)
+{
+    long candidates = 0, pairs = 0;
+
+    if (stencil == false)
+        neighbour_iterate_non_stencil(part, dt_cfl, candidates, pairs);
+    else
+        neighbour_iterate_stencil(part, dt_cfl, candidates, pairs);
+
+    trace.current.candidates += candidates;
+    trace.current.pairs += pairs;
+}
+
+void SPH_main::neighbour_iterate_stencil(SPH_particle* part, double& cfl, long& candidates, long& pairs, bool smooth)
 {
     SPH_particle* other_part;
 
@@ -222,373 +214,1190 @@ void SPH_main::neighbour_iterate(SPH_particle* part, bool stencil, bool change_d
     //vector from 1st to 2nd particle
     double dn[2];
 
-    dt_cfl = 10, dt_f = 10, dt_a = 10;
+    // get the grid index of target particle
+    int i = part->list_num[0];
+    int j = part->list_num[1];
 
-    if (stencil == false)
-    {
-        neighbour_iterate_non_stencil(part, stencil, change_delta_t);
-    }
+    // set two array to loop for the grid that the taget particle need to find
+    int i_list[5]{ i,  i - 1,     i,  i + 1,  i + 1 };
+    int j_list[5]{ j,  j + 1, j + 1,  j + 1,      j };
 
-    else if (stencil == true)
+    auto visit = [&](int first, int last)
     {
-        // get the grid index of target particle
-        int i = part->list_num[0];
-        int j = part->list_num[1];
-
-        // set two array to loop for the grid that the taget particle need to find
-        int i_list[5]{ i,  i - 1,     i,  i + 1,  i + 1 };
-        int j_list[5]{ j,  j + 1, j + 1,  j + 1,      j };
+        candidates += last - first;
 
-        //        omp_set_num_threads(5);
-        //#pragma omp parallel for
-        for (int cn = 0; cn < 5; cn++)
+        for (int m = first; m < last; m++)
         {
-            if (i_list[cn] >= 0 && i_list[cn] < max_list[0] && j_list[cn] >= 0 && j_list[cn] < max_list[1])
-                // Set the boundary of the index of neighbour_grid
+            other_part = &particle_list[m];
+
+            // calculates the distance between potential neighbours
+            for (int n = 0; n < 2; n++)
+                dn[n] = part->x[n] - other_part->x[n];
+
+            dist = sqrt(dn[0] * dn[0] + dn[1] * dn[1]);
+
+            // only particle within 2h
+            if (dist < 2. * h)
             {
-                if (cn != 0)
+                pairs++;
+                update_a_D(part, other_part, dist, true);
+
+                // dt_cfl of the pair
+                double dvx = part->v[0] - other_part->v[0], dvy = part->v[1] - other_part->v[1];
+                cfl = min(cfl, SPH_time_step::cfl_limit(h, dvx * dvx + dvy * dvy));
+
+                // W is symmetric, so one evaluation serves the Shepard sums of both particles
+                if (smooth)
                 {
-                    //        #pragma omp parallel for
-                    for (int m = 0; m < search_grid[i_list[cn]][j_list[cn]].size(); m++)
-                    {
-                        other_part = search_grid[i_list[cn]][j_list[cn]][m];
+                    double W = calculate_W(dist);
+                    int p = int(part - particle_list.data());
+                    soa.w_sum[p] += W;
+                    soa.w_rho[p] += W / other_part->rho;
+                    soa.w_sum[m] += W;
+                    soa.w_rho[m] += W / part->rho;
+                }
+            }
+        }
+    };
 
-                        // calculates the distance between potential neighbours
-                        for (int n = 0; n < 2; n++)
-                            dn[n] = part->x[n] - other_part->x[n];
+    for (int cn = 0; cn < 5; cn++)
+    {
+        // Set the boundary of the index of neighbour_grid
+        if (i_list[cn] < 0 || i_list[cn] >= max_list[0] || j_list[cn] < 0 || j_list[cn] >= max_list[1])
+            continue;
 
-                        dist = sqrt(dn[0] * dn[0] + dn[1] * dn[1]);
+        // in its own cell only the particles before part are visited, the others visit part themselves
+        int first = cells.begin(i_list[cn], j_list[cn]);
+        visit(first, cn == 0 ? first + int(part->grid_index) : cells.end(i_list[cn], j_list[cn]));
+    }
 
-                        // only particle within 2h
-                        if (dist < 2. * h)
-                        {
-                            update_a_D(part, other_part, dist, stencil);
-                            update_dynamical_t(part, other_part);
-                        }
-                    }
-                }
-                else if (cn == 0)
-                {
-                    //        #pragma omp parallel for
-                    for (int m = part->grid_index - 1; m >= 0; m--)
-                    {
-                        other_part = search_grid[i][j][m];
+    // boundary particles never visit anyone, so their pairs are all taken from the fluid side
+    for (int ci = max(i - 1, 0); ci <= min(i + 1, max_list[0] - 1); ci++)
+        for (int cj = max(j - 1, 0); cj <= min(j + 1, max_list[1] - 1); cj++)
+            visit(boundary.cells.begin(ci, cj), boundary.cells.end(ci, cj));
+}
 
-                        // calculates the distance between potential neighbours
-                        for (int n = 0; n < 2; n++)
-                            dn[n] = part->x[n] - other_part->x[n];
+void SPH_main::compute_forces(bool stencil, bool change_delta_t, bool smooth)
+{
+    // the non-stencil loop visits every pair twice, so it keeps the separate smoothing pass
+    if (smooth && !stencil)
+        smoothing();
 
-                        dist = sqrt(dn[0] * dn[0] + dn[1] * dn[1]);
+    SPH_phase_timer timer(trace, &SPH_step_record::t_forces);
 
-                        // only particle within 2h
-                        if (dist < 2. * h)
-                        {
-                            update_a_D(part, other_part, dist, stencil);
-                            update_dynamical_t(part, other_part);
-                        }
-                    }
-                }
-            }
+    // it needs to reset acceleration and density to zero before any pair is visited
+#pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < int(particle_list.size()); i++)
+    {
+        particle_list[i].a[0] = 0;
+        if (particle_list[i].boundary_status)
+            particle_list[i].a[1] = 0;
+        else
+            particle_list[i].a[1] = G;
+        particle_list[i].D = 0;
+    }
+
+    double cfl = SPH_DT_NONE;
+    long candidates = 0, pairs = 0;
+
+    if (!stencil)
+    {
+        // every particle only writes itself, so the particles need no colouring
+#pragma omp parallel for schedule(dynamic, 64) reduction(min:cfl) reduction(+:candidates, pairs) num_threads(num_threads)
+        for (int i = 0; i < int(particle_list.size()); i++)
+            neighbour_iterate_non_stencil(&(particle_list[i]), cfl, candidates, pairs);
+    }
+    else
+    {
+        if (smooth)
+        {
+            soa.resize(particle_list.size());
+            begin_shepard();
+        }
+
+        // cells of one colour are at least 3 cells apart, so the 3x3 cells written around them never overlap
+        for (int colour = 0; colour < 9; colour++)
+        {
+            int ci0 = colour / 3, cj0 = colour % 3;
+
+#pragma omp parallel for collapse(2) schedule(dynamic, 4) reduction(min:cfl) reduction(+:candidates, pairs) num_threads(num_threads)
+            for (int ci = ci0; ci < max_list[0]; ci += 3)
+                for (int cj = cj0; cj < max_list[1]; cj += 3)
+                    for (int m = cells.begin(ci, cj); m < cells.end(ci, cj); m++)
+                        neighbour_iterate_stencil(&(particle_list[m]), cfl, candidates, pairs, smooth);
         }
+
+        if (smooth)
+            finish_shepard();
+    }
+
+    trace.current.candidates += candidates;
+    trace.current.pairs += pairs;
+
+    // the accelerations of the particles are only final once every pair has been visited
+    if (change_delta_t)
+    {
+        double force, acoustic;
+        particle_limits(force, acoustic);
+        set_delta_t(cfl, force, acoustic);
     }
 }
 
+void SPH_main::begin_shepard()
+{
+    visit_kernel(kernel, tabulate_kernel, [&](auto policy)
+    {
+        using Kernel = decltype(policy);
+        const double inv_h = 1.0 / h;
+        const double norm = Kernel::norm * inv_h * inv_h;
+        const double w0 = norm * Kernel::w(0);
 
-//    -------------------------------------------------------------------------------
-double SPH_main::calculate_W(double r)
+#pragma omp parallel for num_threads(num_threads)
+        for (int i = 0; i < int(particle_list.size()); i++)
+        {
+            soa.w_sum[i] = w0;
+            soa.w_rho[i] = w0 / particle_list[i].rho;
+        }
+
+        // the force loops only visit pairs with a fluid particle, the boundary pairs are listed once
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads)
+        for (int i = 0; i < boundary.n; i++)
+            for (int k = boundary.start[i]; k < boundary.start[i + 1]; k++)
+            {
+                double W = norm * Kernel::w(boundary.dist[k] * inv_h);
+                soa.w_sum[i] += W;
+                soa.w_rho[i] += W / particle_list[boundary.neighbours[k]].rho;
+            }
+    });
+}
+
+void SPH_main::finish_shepard()
 {
-    double q = r / h;
-    double tmp;
+    // the forces of this sweep were computed with the densities before smoothing
+#pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < int(particle_list.size()); i++)
+        particle_list[i].rho = soa.w_sum[i] / soa.w_rho[i];
+}
 
-    if (q >= 0 && q <= 1)
-        tmp = 1 - 1.5 * q * q + 0.75 * q * q * q;
-    else if (q > 1 && q <= 2)
-        tmp = 0.25 * pow((2 - q), 3);
-    else
-        return 0;
+void SPH_main::particle_limits(double& force, double& acoustic)
+{
+    double f = SPH_DT_NONE, a = SPH_DT_NONE;
+
+#pragma omp parallel for reduction(min:f, a) num_threads(num_threads)
+    for (int i = 0; i < int(particle_list.size()); i++)
+    {
+        const SPH_particle& part = particle_list[i];
+
+        // the acceleration of a ghost misses the particles beyond the halo, its owner takes its limits
+        if (part.ghost)
+            continue;
+        if (!part.boundary_status)
+            f = min(f, SPH_time_step::force_limit(h, part.a[0] * part.a[0] + part.a[1] * part.a[1]));
+        a = min(a, SPH_time_step::acoustic_limit(h, C0, part.rho / rho0));
+    }
 
-    return (10 / 7.0 / PI / h / h) * tmp;
+    force = f;
+    acoustic = a;
 }
 
-double SPH_main::calculate_dW(double r)
+void SPH_main::set_delta_t(double cfl, double force, double acoustic, int steps, bool grow)
 {
-    double q = r / h;
-    double tmp;
+    dt_cfl = cfl;
+    dt_f = force;
+    dt_a = acoustic;
 
-    if (q >= 0 && q <= 1)
-        tmp = -3 * q + 2.25 * q * q;
-    else if (q > 1 && q <= 2)
-        tmp = -0.75 * pow((2 - q), 2);
-    else
-        return 0;
+    // every process takes part in the reduction of next, so they all decide alike
+    double next = time_step.next(delta_t, cfl, force, acoustic, steps);
+    if (grow || next < delta_t)
+    {
+        delta_t = next;
+        trace.current.limiter = time_step.limiter;
+    }
+}
+
+// pair kernel of the batched force loops, index(k) gives the k-th candidate of particle i and is also
+// called for up to SPH_BATCH - 1 positions past n, where it has to return an index that can be read.
+// Boundary particles, fluid false, only accumulate the density change
+template <class Kernel, bool smooth, bool fluid, class Index>
+static void batch_pairs(SPH_soa& soa, int i, int n, Index index, double h, double m_j, double& cfl_min, long& pairs)
+{
+    const double two_h = 2.0 * h;
+    const double inv_h = 1.0 / h;
+    const double norm = Kernel::norm * inv_h * inv_h * inv_h;
+
+    // fields of the target particle
+    const double xi = soa.x[i], yi = soa.y[i];
+    const double vxi = soa.vx[i], vyi = soa.vy[i];
+    const double P_rho2_i = soa.P_rho2[i], inv_rho2_i = soa.inv_rho2[i];
+
+    double ax = 0, ay = 0, D = 0, cfl = cfl_min;
+    double w_sum = 0, w_rho = 0;
+    int found = 0;
+
+    const double* bx = soa.x.data();
+    const double* by = soa.y.data();
+    const double* bvx = soa.vx.data();
+    const double* bvy = soa.vy.data();
+    const double* bP_rho2 = soa.P_rho2.data();
+    const double* binv_rho2 = soa.inv_rho2.data();
+    const double* brho = soa.rho.data();
+
+    for (int start = 0; start < n; start += SPH_BATCH)
+    {
+        int len = min(SPH_BATCH, n - start);
+
+#pragma omp simd reduction(+:ax, ay, D, w_sum, w_rho, found) reduction(min:cfl)
+        for (int b = 0; b < SPH_BATCH; b++)
+        {
+            int j = index(start + b);
+            double dxij = xi - bx[j], dyij = yi - by[j];
+            double dvx = vxi - bvx[j], dvy = vyi - bvy[j];
+            double r2 = dxij * dxij + dyij * dyij;
+            double dist = sqrt(r2);
+
+            // only particle within 2h, excluding the particle itself and the reads past the last candidate
+            bool inside = b < len && r2 > 0 && dist < two_h;
+
+            double w = 0, dw;
+            if constexpr (smooth)
+                Kernel::w_dw(dist * inv_h, w, dw);
+            else
+                dw = Kernel::dw(dist * inv_h);
+
+            double f = inside ? m_j * norm * dw / dist : 0;
+            found += inside;
+
+            // shape of W only, normalised once per particle below, and 1 / rho = rho / rho^2 saves a division
+            if constexpr (smooth)
+            {
+                w_sum += inside ? w : 0;
+                w_rho += inside ? w * brho[j] * binv_rho2[j] : 0;
+            }
+
+            if constexpr (fluid)
+            {
+                ax += f * (mu * (inv_rho2_i + binv_rho2[j]) * dvx - (P_rho2_i + bP_rho2[j]) * dxij);
+                ay += f * (mu * (inv_rho2_i + binv_rho2[j]) * dvy - (P_rho2_i + bP_rho2[j]) * dyij);
+            }
+            D += f * (dvx * dxij + dvy * dyij);
+
+            // dt_cfl of the pair
+            double v2 = dvx * dvx + dvy * dvy;
+            double tmp_cfl = inside && v2 > 0 ? h / sqrt(v2) : cfl;
+            cfl = tmp_cfl < cfl ? tmp_cfl : cfl;
+        }
+    }
+
+    if constexpr (fluid)
+    {
+        soa.ax[i] += ax;
+        soa.ay[i] += ay;
+    }
+    soa.D[i] += D;
+    if constexpr (smooth)
+    {
+        soa.w_sum[i] += norm * h * w_sum;
+        soa.w_rho[i] += norm * h * w_rho;
+    }
 
-    return (10 / 7.0 / PI / h / h / h) * tmp;
+    cfl_min = cfl;
+    pairs += found;
 }
 
-double distance(SPH_particle& i, SPH_particle& j)
+template <class Kernel, bool smooth, bool fluid>
+void SPH_main::update_a_D_batch(int i, int first, int last, double& cfl, long& candidates, long& pairs)
 {
-    double x_2 = pow((i.x[0] - j.x[0]), 2);
-    double y_2 = pow((i.x[1] - j.x[1]), 2);
+    // the candidates are contiguous, the last batch reads into the following cells or the padding of soa
+    batch_pairs<Kernel, smooth, fluid>(soa, i, last - first, [first](int k) { return first + k; }, h, dx * dx * rho0, cfl, pairs);
+    candidates += last - first;
+}
 
-    return sqrt(x_2 + y_2);
+template <class Kernel, bool smooth, bool fluid>
+void SPH_main::update_a_D_verlet(int i, double& cfl, long& candidates, long& pairs)
+{
+    const int* nbr = verlet.neighbours.data() + verlet.start[i];
+    int n = verlet.start[i + 1] - verlet.start[i];
+
+    // reads past the end of the list fall back to the particle itself, which is masked by its zero distance
+    batch_pairs<Kernel, smooth, fluid>(soa, i, n, [nbr, n, i](int k) { return k < n ? nbr[k] : i; }, h, dx * dx * rho0, cfl, pairs);
+    candidates += n;
 }
 
-void SPH_main::smoothing()
+template <class Kernel, bool smooth, bool fluid>
+void SPH_main::neighbour_iterate_batched(int i, double& cfl, long& candidates, long& pairs)
 {
-    SPH_particle* other_part;
-    double dn[2];
-    double dist;
+    const SPH_particle& part = particle_list[i];
 
-    double W;
-    // loop all neighbour grid and its own grid to find neighbouring particles
-//#pragma omp parallel for private(W, dist, dn, other_part)
-    for (int ii = 0; ii != particle_list.size(); ii++)
-    {
-        double numerator_sum = 0;
-        double denominator_sum = 0;
-        for (int i = particle_list[ii].list_num[0] - 1; i <= particle_list[ii].list_num[0] + 1; i++)
-            if (i >= 0 && i < max_list[0])
-                for (int j = particle_list[ii].list_num[1] - 1; j <= particle_list[ii].list_num[1] + 1; j++)
-                    if (j >= 0 && j < max_list[1])
-                    {
-                        for (unsigned int cnt = 0; cnt < search_grid[i][j].size(); cnt++)
-                        {
-                            other_part = search_grid[i][j][cnt];
+    // cells (ci, j - 1) to (ci, j + 1) are stored one after another in row order
+    int j_lo = max(part.list_num[1] - 1, 0);
+    int j_hi = min(part.list_num[1] + 1, max_list[1] - 1);
 
-                            // calculates the distance between potential neighbours
-                            for (int n = 0; n < 2; n++)
-                                dn[n] = particle_list[ii].x[n] - other_part->x[n];
+    auto batch = [&](int first, int last) { update_a_D_batch<Kernel, smooth, fluid>(i, first, last, cfl, candidates, pairs); };
 
-                            dist = sqrt(dn[0] * dn[0] + dn[1] * dn[1]);
+    for (int ci = part.list_num[0] - 1; ci <= part.list_num[0] + 1; ci++)
+        if (ci >= 0 && ci < max_list[0])
+        {
+            cells.column_ranges(ci, j_lo, j_hi, batch);
 
-                            // only particle within 2h
-                            if (dist < 2. * h)
-                            {
-                                W = calculate_W(dist);
-                                numerator_sum += W;
-                                denominator_sum += W / other_part->rho;
-                            }
-                        }
-                    }
-        particle_list[ii].rho = numerator_sum / denominator_sum;
+            // two boundary particles change neither acceleration nor density of each other
+            if constexpr (fluid)
+                boundary.cells.column_ranges(ci, j_lo, j_hi, batch);
+        }
+}
+
+template <class Kernel, bool smooth>
+void SPH_main::batched_particle(int i, bool change_delta_t, double& cfl, double& force, double& acoustic, long& candidates, long& pairs)
+{
+    // the boundary particles come first
+    if (i < boundary.n)
+        neighbour_iterate_batched<Kernel, smooth, false>(i, cfl, candidates, pairs);
+    else
+        neighbour_iterate_batched<Kernel, smooth, true>(i, cfl, candidates, pairs);
+
+    // the particle owns its accumulators, so its limits can be taken right away, those of a ghost by its owner
+    if (change_delta_t && !particle_list[i].ghost)
+    {
+        if (i >= boundary.n)
+            force = min(force, SPH_time_step::force_limit(h, soa.ax[i] * soa.ax[i] + soa.ay[i] * soa.ay[i]));
+        acoustic = min(acoustic, SPH_time_step::acoustic_limit(h, C0, soa.rho[i] / rho0));
     }
 }
 
-void SPH_main::forward_euler(bool smooth, bool stencil)
+template <class Particle>
+void SPH_main::sweep_tiles(Particle particle, double& cfl, double& force, double& acoustic, long& candidates, long& pairs)
 {
-    allocate_to_grid();
+    int tiles_y = (max_list[1] + tile_cells - 1) / tile_cells;
+    int n_tiles = (max_list[0] + tile_cells - 1) / tile_cells * tiles_y;
+    if (int(tile_pairs.size()) != n_tiles)
+        tile_pairs.assign(n_tiles, 0);
 
-    // generally it needs to smooth the density every ten to twenty updates
-    if (smooth)
+    // call visit(first, last) for the ranges of fluid and boundary particles in tile t
+    auto for_each_range = [&](int t, auto visit)
     {
-        smoothing();
+        int i_lo = t / tiles_y * tile_cells, j_lo = t % tiles_y * tile_cells;
+        int i_hi = min(i_lo + tile_cells, max_list[0]) - 1, j_hi = min(j_lo + tile_cells, max_list[1]) - 1;
+        for (int ci = i_lo; ci <= i_hi; ci++)
+        {
+            boundary.cells.column_ranges(ci, j_lo, j_hi, visit);
+            cells.column_ranges(ci, j_lo, j_hi, visit);
+        }
+    };
+
+    // the tiles with particles, in row order so that the tiles of one thread are neighbours, and their particle ranges
+    tile_tasks.clear();
+    tile_cost.clear();
+    tile_ranges.clear();
+    tile_range_start.assign(1, 0);
+    for (int t = 0; t < n_tiles; t++)
+    {
+        long particles = 0;
+        for_each_range(t, [&](int first, int last)
+        {
+            if (last > first)
+            {
+                tile_ranges.push_back(first);
+                tile_ranges.push_back(last);
+                particles += last - first;
+            }
+        });
+
+        if (particles > 0)
+        {
+            tile_tasks.push_back(t);
+            tile_cost.push_back(double(max(tile_pairs[t], particles)));
+            tile_range_start.push_back(int(tile_ranges.size()));
+        }
     }
 
-    //#pragma omp parallel for
-    for (int i = 0; i != particle_list.size(); i++)
+    scheduler.plan(tile_cost, num_threads);
+
+#pragma omp parallel reduction(min:cfl, force, acoustic) reduction(+:candidates, pairs) num_threads(num_threads)
+    scheduler.work(SPH_work_stealing::worker_id(), [&](int task)
     {
-        // it needs to reset acceleration and density to zero at beginning
-        particle_list[i].a[0] = 0;
-        if (particle_list[i].boundary_status)
-            particle_list[i].a[1] = 0;
-        else
-            particle_list[i].a[1] = G;
-        particle_list[i].D = 0;
+        long before = pairs;
+        for (int r = tile_range_start[task]; r < tile_range_start[task + 1]; r += 2)
+            for (int i = tile_ranges[r]; i < tile_ranges[r + 1]; i++)
+                particle(i, cfl, force, acoustic, candidates, pairs);
+
+        // the tile is only run by this thread, and its pairs estimate its cost in the next sweep
+        tile_pairs[tile_tasks[task]] = pairs - before;
+    });
+}
+
+void SPH_main::activate_particles(bool all)
+{
+    int n = int(particle_list.size());
+    int top = step_levels;
+    step_active.resize(n);
+    level_floor.resize(n);
+    step_limit.resize(n);
+
+    // the finest level in every occupied cell, the particles being sorted into the cells they are in
+    cell_level.assign(cells.n_slots(), 0);
+    boundary_level.assign(boundary.cells.n_slots(), 0);
+    for (int i = 0; i < n; i++)
+    {
+        SPH_particle& part = particle_list[i];
+        part.level = min(part.level, top);
+        const SPH_cell_list& binned = i < boundary.n ? boundary.cells : cells;
+        char& finest = (i < boundary.n ? boundary_level : cell_level)[binned.slot(part.list_num[0], part.list_num[1])];
+        finest = max(finest, char(part.level));
+    }
+
+    int active = 0;
+#pragma omp parallel for reduction(+:active) num_threads(num_threads)
+    for (int i = 0; i < n; i++)
+    {
+        SPH_particle& part = particle_list[i];
+
+        // no particle is more than one level coarser than those around it
+        int floor = 0;
+        for (int ci = max(part.list_num[0] - 1, 0); ci <= min(part.list_num[0] + 1, max_list[0] - 1); ci++)
+            for (int cj = max(part.list_num[1] - 1, 0); cj <= min(part.list_num[1] + 1, max_list[1] - 1); cj++)
+            {
+                int fluid = cells.slot(ci, cj), wall = boundary.cells.slot(ci, cj);
+                if (fluid >= 0)
+                    floor = max(floor, cell_level[fluid] - 1);
+                if (wall >= 0)
+                    floor = max(floor, boundary_level[wall] - 1);
+            }
+        level_floor[i] = floor;
+
+        bool woken = part.level < floor;
+        if (woken)
+            part.level = floor;
 
-        neighbour_iterate(&(particle_list[i]), stencil);
+        step_active[i] = all || woken || sub_step % (1L << (top - part.level)) == 0;
+        active += step_active[i];
     }
+    n_active = active;
+}
 
-    //#pragma omp parallel for
-    for (int i = 0; i != particle_list.size(); i++)
+void SPH_main::assign_levels()
+{
+    int top = step_levels;
+
+    // the coarsest level whose steps start at this step
+    int aligned = 0;
+    if (sub_step > 0)
     {
-        if (particle_list[i].boundary_status == true)
+        aligned = top;
+        for (long s = sub_step; s % 2 == 0; s /= 2)
+            aligned--;
+    }
+
+#pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < int(particle_list.size()); i++)
+        if (step_active[i])
         {
-            particle_list[i].v[0] = 0;
-            particle_list[i].v[1] = 0;
-            particle_list[i].boundary_status = true;
+            int level = 0;
+            double step = delta_t * double(1L << top);
+            while (level < top && step > time_step.safety * step_limit[i])
+            {
+                step *= 0.5;
+                level++;
+            }
+            particle_list[i].level = max(level, max(aligned, level_floor[i]));
         }
-        else
+
+    sub_step = (sub_step + 1) % (1L << top);
+}
+
+void SPH_main::compute_forces_batched(bool change_delta_t, bool smooth)
+{
+    SPH_phase_timer timer(trace, &SPH_step_record::t_forces);
+
+    soa.gather(particle_list, G, num_threads);
+
+    // the smoothing replaces the densities of all particles, so all of them compute their sums
+    bool individual = use_individual_steps;
+    if (individual)
+        activate_particles(smooth);
+
+    double cfl = SPH_DT_NONE, force = SPH_DT_NONE, acoustic = SPH_DT_NONE;
+    long candidates = 0, pairs = 0;
+
+    // every particle only writes its own accumulators, so the particles are independent
+    visit_kernel(kernel, tabulate_kernel, [&](auto policy)
+    {
+        using Kernel = decltype(policy);
+
+        // the pair kernel returns W along with dW when smoothing is due, so it costs no extra traversal
+        auto sweep = [&](auto fused)
         {
-            bool wall[2] = { false, false };
-            for (int k = 0; k != 2; k++)
+            constexpr bool fuse = decltype(fused)::value;
+            auto particle = [&](int i, double& cfl, double& force, double& acoustic, long& candidates, long& pairs)
             {
-                particle_list[i].x[k] = particle_list[i].x[k] + delta_t * particle_list[i].v[k];
-                if (particle_list[i].x[k] < inner_min_x[k] || particle_list[i].x[k] > inner_max_x[k])
+                if (!individual)
                 {
-                    particle_list[i].x[k] = particle_list[i].x[k] - delta_t * particle_list[i].v[k];
-                    particle_list[i].v[k] = -velocity_lost_rate * particle_list[i].v[k];
-                    wall[k] = true;
+                    batched_particle<Kernel, fuse>(i, change_delta_t, cfl, force, acoustic, candidates, pairs);
+                    return;
                 }
 
-                if (!wall[k])
-                    particle_list[i].v[k] = particle_list[i].v[k] + delta_t * particle_list[i].a[k];
+                // an inactive particle keeps the acceleration and density change of its last computation
+                if (!step_active[i])
+                {
+                    soa.ax[i] = particle_list[i].a[0];
+                    soa.ay[i] = particle_list[i].a[1];
+                    soa.D[i] = particle_list[i].D;
+                    return;
+                }
+
+                // the limits of the particle itself choose its level
+                double own_cfl = SPH_DT_NONE, own_force = SPH_DT_NONE, own_acoustic = SPH_DT_NONE;
+                batched_particle<Kernel, fuse>(i, true, own_cfl, own_force, own_acoustic, candidates, pairs);
+                step_limit[i] = min(own_cfl, min(own_force, own_acoustic));
+                cfl = min(cfl, own_cfl);
+                force = min(force, own_force);
+                acoustic = min(acoustic, own_acoustic);
+            };
+
+            if (use_work_stealing)
+                sweep_tiles(particle, cfl, force, acoustic, candidates, pairs);
+            else
+            {
+#pragma omp parallel for schedule(dynamic, 256) reduction(min:cfl, force, acoustic) reduction(+:candidates, pairs) num_threads(num_threads)
+                for (int i = 0; i < int(soa.size()); i++)
+                    particle(i, cfl, force, acoustic, candidates, pairs);
             }
+        };
+
+        if (smooth)
+        {
+            begin_shepard();
+            sweep(true_type());
         }
-        particle_list[i].rho = particle_list[i].rho + delta_t * particle_list[i].D;
-        particle_list[i].calculate_P();
-        particle_list[i].calc_index();
-    }
-}
+        else
+            sweep(false_type());
+    });
 
+    soa.scatter(particle_list, num_threads);
+    trace.current.candidates += candidates;
+    trace.current.pairs += pairs;
 
-// predictor corrector scheme which is second-order scheme
-void SPH_main::predictor_corrector(bool smooth, bool change_delta_t)
-{
     if (smooth)
+        finish_shepard();
+
+    // delta_t is the step of the finest level, so it only grows, over the whole last cycle, when all levels start a
+    // step together, and shrinks as soon as a computed particle needs it
+    if (change_delta_t)
     {
-        smoothing();
+        if (!individual)
+            set_delta_t(cfl, force, acoustic);
+        else
+            set_delta_t(cfl, force, acoustic, sub_step == 0 ? 1 << step_levels : 1, sub_step == 0);
     }
 
-    allocate_to_grid();
-    // Update and search neighbour
-    for (int i = 0; i != particle_list.size(); i++)
+    if (individual)
+        assign_levels();
+}
+
+void SPH_main::compute_forces_verlet(bool change_delta_t, bool smooth)
+{
+    SPH_phase_timer timer(trace, &SPH_step_record::t_forces);
+
+    soa.gather(particle_list, G, num_threads);
+
+    double cfl = SPH_DT_NONE, force = SPH_DT_NONE, acoustic = SPH_DT_NONE;
+    long candidates = 0, pairs = 0;
+
+    // the lists hold both directions of every pair, so every particle only writes its own accumulators
+    visit_kernel(kernel, tabulate_kernel, [&](auto policy)
     {
+        using Kernel = decltype(policy);
 
-        particle_list[i].a[0] = 0;
-        if (particle_list[i].boundary_status)
-            particle_list[i].a[1] = 0;
+        // the pair kernel returns W along with dW when smoothing is due, so it costs no extra traversal
+        auto sweep = [&](auto fused)
+        {
+            constexpr bool fuse = decltype(fused)::value;
+            auto particle = [&](int i, double& cfl, double& force, double& acoustic, long& candidates, long& pairs)
+            {
+                // the boundary particles come first
+                if (i < boundary.n)
+                    update_a_D_verlet<Kernel, fuse, false>(i, cfl, candidates, pairs);
+                else
+                    update_a_D_verlet<Kernel, fuse, true>(i, cfl, candidates, pairs);
+
+                // the particle owns its accumulators, so its limits can be taken right away, those of a ghost by its owner
+                if (change_delta_t && !particle_list[i].ghost)
+                {
+                    if (i >= boundary.n)
+                        force = min(force, SPH_time_step::force_limit(h, soa.ax[i] * soa.ax[i] + soa.ay[i] * soa.ay[i]));
+                    acoustic = min(acoustic, SPH_time_step::acoustic_limit(h, C0, soa.rho[i] / rho0));
+                }
+            };
+
+            if (use_work_stealing)
+                sweep_tiles(particle, cfl, force, acoustic, candidates, pairs);
+            else
+            {
+#pragma omp parallel for schedule(dynamic, 256) reduction(min:cfl, force, acoustic) reduction(+:candidates, pairs) num_threads(num_threads)
+                for (int i = 0; i < int(soa.size()); i++)
+                    particle(i, cfl, force, acoustic, candidates, pairs);
+            }
+        };
+
+        if (smooth)
+        {
+            begin_shepard();
+            sweep(true_type());
+        }
         else
-            particle_list[i].a[1] = G;
+            sweep(false_type());
+    });
 
-        particle_list[i].D = 0;
-        neighbour_iterate(&(particle_list[i]), smooth, change_delta_t);
+    soa.scatter(particle_list, num_threads);
+    trace.current.candidates += candidates;
+    trace.current.pairs += pairs;
+
+    if (smooth)
+        finish_shepard();
+
+    if (change_delta_t)
+        set_delta_t(cfl, force, acoustic);
+}
+
+
+bool SPH_main::pipeline_supported(bool smooth) const
+{
+    // the global minimum over MPI processes must not be taken from a worker thread, the driver initialises MPI without threads
+    if (time_step.reduce_min)
+        return false;
+
+    return use_pipeline && use_soa && !use_verlet && !use_individual_steps && !smooth && cell_order == SPH_ORDER_ROWS && cell_storage != SPH_CELLS_SPARSE && !cells.sparse;
+}
+
+bool SPH_main::step_pipeline(bool predictor_corrector, bool change_delta_t)
+{
+    // the blocks only know where to find their particles if the last step was pipelined and nothing was added since
+    if (!pipeline_sorted || !boundary.binned || cells.cell_start.back() != int(particle_list.size()))
+        allocate_to_grid();
+
+    // the automatic storage may just have switched to the hash, which the blocks do not write
+    if (cells.sparse)
+        return false;
+
+    // the particles are already in their cells after a sort
+    if (!pipeline_sorted)
+    {
+        moved_cell.resize(particle_list.size());
+#pragma omp parallel for num_threads(num_threads)
+        for (int i = boundary.n; i < int(particle_list.size()); i++)
+            moved_cell[i] = cells.rank[cells.cell_id(particle_list[i].list_num[0], particle_list[i].list_num[1])];
+    }
+
+    SPH_phase_timer timer(trace, &SPH_step_record::t_forces);
+
+    int ny = max_list[1];
+    int columns = max(block_columns, 2);
+    int n_blocks = (max_list[0] + columns - 1) / columns;
+    auto first_column = [&](int b) { return min(b * columns, max_list[0]); };
+
+    // where the fluid particles of every block were sorted in the last step
+    block_old_start.resize(n_blocks + 1);
+    for (int b = 0; b <= n_blocks; b++)
+        block_old_start[b] = cells.cell_start[first_column(b) * ny];
+
+    block_count.resize(n_blocks);
+    block_start.resize(n_blocks + 1);
+    block_start[0] = boundary.n;
+    block_occupied.resize(n_blocks);
+    block_far.assign(n_blocks, 0);
+    block_cfl.resize(n_blocks);
+    block_force.resize(n_blocks);
+    block_acoustic.resize(n_blocks);
+    block_candidates.resize(n_blocks);
+    block_pairs.resize(n_blocks);
+
+    // the particles are sorted from the order of the last step, kept in the sorting buffer, into particle_list
+    vector<SPH_particle>& old = cells.sorted;
+    old.resize(particle_list.size());
+    particle_list.swap(old);
+    soa.resize(particle_list.size());
+    next_cell.resize(particle_list.size());
+    if (predictor_corrector)
+        allocate_previous_state();
+
+    // five tasks per block, and one taking the limits of all blocks
+    enum { COUNT, PREFIX, SORT, FORCES, INTEGRATE };
+    auto task = [n_blocks](int phase, int b) { return phase * n_blocks + b; };
+    int limits = 5 * n_blocks;
+
+    graph.clear(5 * n_blocks + 1);
+    for (int b = 0; b < n_blocks; b++)
+    {
+        graph.depend(task(PREFIX, b), task(COUNT, b));
+        if (b > 0)
+            graph.depend(task(PREFIX, b), task(PREFIX, b - 1));
+        graph.depend(task(SORT, b), task(PREFIX, b));
+        for (int nb = max(b - 1, 0); nb <= min(b + 1, n_blocks - 1); nb++)
+            graph.depend(task(FORCES, b), task(SORT, nb));
+        graph.depend(limits, task(FORCES, b));
+
+        // a new delta_t needs the limits of every block before any particle moves
+        graph.depend(task(INTEGRATE, b), change_delta_t ? limits : task(FORCES, b));
     }
+    graph.prepare();
 
-    // Loop two times. The first loop is hal-f step, the second loop is full-step
-    for (int step = 0; step < 2; step++)
+    // the particles that were in blocks b - 1 to b + 1 in the last step and now lie in the cells of block b
+    auto for_each_arrival = [&](int b, auto visit)
+    {
+        int c_lo = first_column(b) * ny, c_hi = first_column(b + 1) * ny;
+        for (int k = block_old_start[max(b - 1, 0)]; k < block_old_start[min(b + 2, n_blocks)]; k++)
+            if (moved_cell[k] >= c_lo && moved_cell[k] < c_hi)
+                visit(k, moved_cell[k]);
+    };
+
+    // call visit(first, last) for the boundary particles of block b, and then its fluid particles
+    auto for_each_range = [&](int b, auto visit)
     {
+        for (int ci = first_column(b); ci < first_column(b + 1); ci++)
+            boundary.cells.column_ranges(ci, 0, ny - 1, visit);
+        visit(block_start[b], block_start[b + 1]);
+    };
 
+    visit_kernel(kernel, tabulate_kernel, [&](auto policy)
+    {
+        using Kernel = decltype(policy);
 
-        if (step == 0) // Run half-step
+#pragma omp parallel num_threads(num_threads)
+        graph.work([&](int t)
         {
-            for (int i = 0; i != particle_list.size(); i++)
+            int b = t % n_blocks;
+            int c_lo = first_column(b) * ny, c_hi = first_column(b + 1) * ny;
+
+            if (t == limits)
             {
-                // if the particle is boundary, velocity is 0
-                if (particle_list[i].boundary_status == true)
+                if (change_delta_t)
                 {
-                    for (int k = 0; k != 2; k++)
+                    double cfl = SPH_DT_NONE, force = SPH_DT_NONE, acoustic = SPH_DT_NONE;
+                    for (int k = 0; k < n_blocks; k++)
                     {
-                        // set current boundary velocity to 0.
-                        particle_list[i].v[k] = 0;
-
-                        // particle_list[i].boundary_status = true;
-                         // sst previous boundary velocity to 0.
-                        particle_list[i].prev_v[k] = 0;
+                        cfl = min(cfl, block_cfl[k]);
+                        force = min(force, block_force[k]);
+                        acoustic = min(acoustic, block_acoustic[k]);
                     }
-                    particle_list[i].prev_rho = particle_list[i].rho;
+                    set_delta_t(cfl, force, acoustic);
                 }
-
-                // if the particle is not boundary, update postition first, and check if the position is our of grid's boundary.
-                else
+            }
+            else if (t < task(PREFIX, 0))
+            {
+                // the cells of the block only get particles from the blocks next to it
+                fill(cells.cell_count.begin() + c_lo, cells.cell_count.begin() + c_hi, 0);
+                int count = 0;
+                for_each_arrival(b, [&](int, int c) { cells.cell_count[c]++; count++; });
+                block_count[b] = count;
+            }
+            else if (t < task(SORT, 0))
+                block_start[b + 1] = block_start[b] + block_count[b];
+            else if (t < task(FORCES, 0))
+            {
+                // counting sort into the cells of the block, in the order of the last step like allocate_to_grid
+                int start = block_start[b], occupied = 0;
+                for (int c = c_lo; c < c_hi; c++)
                 {
-                    // Store previous particle information
-                    for (int k = 0; k != 2; k++)
-                    {
-                        particle_list[i].prev_x[k] = particle_list[i].x[k];
-                        particle_list[i].prev_v[k] = particle_list[i].v[k];
-                    }
-                    particle_list[i].prev_rho = particle_list[i].rho;
+                    cells.cell_start[c] = start;
+                    start += cells.cell_count[c];
+                    occupied += cells.cell_count[c] > 0;
+                    cells.cell_count[c] = cells.cell_start[c];
+                }
+                if (b == n_blocks - 1)
+                    cells.cell_start[c_hi] = start;
+                block_occupied[b] = occupied;
 
-                    // Assume all the particals are not close to the wall
-                    bool vertical_wall = false, horizontal_wall = false;
+                for_each_arrival(b, [&](int k, int c)
+                {
+                    int dst = cells.cell_count[c]++;
+                    particle_list[dst] = old[k];
+                    particle_list[dst].grid_index = dst - cells.cell_start[c];
+                });
 
-                    // Update position in x-direction
-                    particle_list[i].x[0] = particle_list[i].x[0] + 0.5 * delta_t * particle_list[i].v[0];
+                for (int c = c_lo; c < c_hi; c++)
+                    cells.cell_count[c] -= cells.cell_start[c];
 
-                    // if the x-direction position is inside wall, or out of boundary
-                    if (particle_list[i].x[0] < inner_min_x[0] || particle_list[i].x[0] > inner_max_x[0])
+                // the boundary particles keep their place
+                for_each_range(b, [&](int first, int last)
+                {
+                    if (first < boundary.n)
+                        copy(old.begin() + first, old.begin() + last, particle_list.begin() + first);
+                    soa.gather(particle_list, G, first, last);
+                });
+            }
+            else if (t < task(INTEGRATE, 0))
+            {
+                double cfl = SPH_DT_NONE, force = SPH_DT_NONE, acoustic = SPH_DT_NONE;
+                long candidates = 0, pairs = 0;
+                for_each_range(b, [&](int first, int last)
+                {
+                    for (int i = first; i < last; i++)
+                        batched_particle<Kernel, false>(i, change_delta_t, cfl, force, acoustic, candidates, pairs);
+                });
+
+                block_cfl[b] = cfl;
+                block_force[b] = force;
+                block_acoustic[b] = acoustic;
+                block_candidates[b] = candidates;
+                block_pairs[b] = pairs;
+            }
+            else
+            {
+                // the other blocks read soa, so the particles of this block can move as soon as its forces are done
+                for_each_range(b, [&](int first, int last)
+                {
+                    soa.scatter(particle_list, first, last);
+                    for (int i = first; i < last; i++)
                     {
-                        // return back to previous x-direction possition, reverse the velocity direction to bounce the particle back
-                        particle_list[i].x[0] = particle_list[i].x[0] - 0.5 * delta_t * particle_list[i].v[0];
-                        particle_list[i].v[0] = -velocity_lost_rate * particle_list[i].prev_v[0];
-                        horizontal_wall = true; // the particle is close to the horizontal wall
-                    }
+                        if (predictor_corrector)
+                        {
+                            predict_particle(i);
+                            correct_particle(i);
+                        }
+                        else
+                            euler_particle(i);
 
-                    // Update position in y-direction
-                    particle_list[i].x[1] = particle_list[i].x[1] + 0.5 * delta_t * particle_list[i].v[1];
-                    if (particle_list[i].x[1] < inner_min_x[1] || particle_list[i].x[1] > inner_max_x[1])
-                    {
-                        // return back to previous y-direction possition, reverse the velocity direction to bounce the particle back
-                        particle_list[i].x[1] = particle_list[i].x[1] - 0.5 * delta_t * particle_list[i].v[1];
-                        particle_list[i].v[1] = -velocity_lost_rate * particle_list[i].prev_v[1];
-                        vertical_wall = true; // the particle is close to the vertical wall
                     }
+                });
 
-                    // Update all particles' velocities that are not close to the wall
-                    if (!vertical_wall)
-                        particle_list[i].v[1] = particle_list[i].v[1] + 0.5 * delta_t * particle_list[i].a[1];
-                    if (!horizontal_wall)
-                        particle_list[i].v[0] = particle_list[i].v[0] + 0.5 * delta_t * particle_list[i].a[0];
+                // the cells the particles have moved to, which the next step sorts them by
+                for (int i = block_start[b]; i < block_start[b + 1]; i++)
+                {
+                    const SPH_particle& part = particle_list[i];
+                    next_cell[i] = cells.rank[cells.cell_id(part.list_num[0], part.list_num[1])];
+                    if (abs(part.list_num[0] / columns - b) > 1)
+                        block_far[b] = 1;
                 }
-
-                // Update density, pressure and particle index using previous time-step result
-                particle_list[i].rho = particle_list[i].rho + 0.5 * delta_t * particle_list[i].D;
-                particle_list[i].calculate_P();
-                particle_list[i].calc_index();
             }
-        }
-        // Run full-step using hal-step results
-        if (step == 1)
+        });
+    });
+
+    moved_cell.swap(next_cell);
+
+    cells.occupied = 0;
+    for (int b = 0; b < n_blocks; b++)
+    {
+        cells.occupied += block_occupied[b];
+        trace.current.candidates += block_candidates[b];
+        trace.current.pairs += block_pairs[b];
+    }
+    if (trace.enabled)
+        trace.current.max_per_cell = cells.max_count();
+
+    // the particles have moved in the list, so the Verlet lists no longer apply
+    verlet.x0.clear();
+    pipeline_sorted = find(block_far.begin(), block_far.end(), 1) == block_far.end();
+
+    timer.stop();
+    trace.end_step(delta_t, particle_list.size());
+    return true;
+}
+
+
+//    -------------------------------------------------------------------------------
+double SPH_main::calculate_W(double r)
+{
+    double inv_h = 1.0 / h;
+    return visit_kernel(kernel, tabulate_kernel, [&](auto policy)
+    {
+        return policy.norm * inv_h * inv_h * policy.w(r * inv_h);
+    });
+}
+
+double SPH_main::calculate_dW(double r)
+{
+    double inv_h = 1.0 / h;
+    return visit_kernel(kernel, tabulate_kernel, [&](auto policy)
+    {
+        return policy.norm * inv_h * inv_h * inv_h * policy.dw(r * inv_h);
+    });
+}
+
+double distance(SPH_particle& i, SPH_particle& j)
+{
+    double x_2 = pow((i.x[0] - j.x[0]), 2);
+    double y_2 = pow((i.x[1] - j.x[1]), 2);
+
+    return sqrt(x_2 + y_2);
+}
+
+void SPH_main::smoothing()
+{
+    SPH_phase_timer timer(trace, &SPH_step_record::t_smoothing);
+
+    rho_smoothed.resize(particle_list.size());
+
+    // the normalisation cancels in the ratio, so only the shape of the kernel is needed
+    visit_kernel(kernel, tabulate_kernel, [&](auto policy)
+    {
+        using Kernel = decltype(policy);
+        const double inv_h = 1.0 / h;
+
+        // loop all neighbour grid and its own grid to find neighbouring particles
+#pragma omp parallel for num_threads(num_threads)
+        for (int ii = 0; ii < int(particle_list.size()); ii++)
         {
-            for (int i = 0; i != particle_list.size(); i++)
+            double numerator_sum = 0;
+            double denominator_sum = 0;
+
+            auto add = [&](const SPH_particle* other_part)
             {
-                // if the particle is boundary, velocity is 0
-                if (particle_list[i].boundary_status == true)
+                // calculates the distance between potential neighbours
+                double dn[2];
+                for (int n = 0; n < 2; n++)
+                    dn[n] = particle_list[ii].x[n] - other_part->x[n];
+
+                double dist = sqrt(dn[0] * dn[0] + dn[1] * dn[1]);
+
+                // only particle within 2h
+                if (dist < 2. * h)
                 {
-                    // set current boundary velocity to 0.
-                    particle_list[i].v[0] = 0;
-                    particle_list[i].v[1] = 0;
-                    particle_list[i].boundary_status = true;
+                    double W = Kernel::w(dist * inv_h);
+                    numerator_sum += W;
+                    denominator_sum += W / other_part->rho;
                 }
+            };
 
-                // if the particle is not boundary, update postition first, and check if the position is our of grid's boundary.
-                else
-                {
-                    // Assume all the particals are not close to the wall
-                    bool vertical_wall = false, horizontal_wall = false;
+            if (use_verlet)
+            {
+                // the Verlet list does not contain the particle itself, nor the other boundary particles of a boundary particle
+                add(&particle_list[ii]);
+                for (int k = verlet.start[ii]; k < verlet.start[ii + 1]; k++)
+                    add(&particle_list[verlet.neighbours[k]]);
+                if (ii < boundary.n)
+                    for (int k = boundary.start[ii]; k < boundary.start[ii + 1]; k++)
+                        add(&particle_list[boundary.neighbours[k]]);
+            }
+            else
+                for (int i = particle_list[ii].list_num[0] - 1; i <= particle_list[ii].list_num[0] + 1; i++)
+                    if (i >= 0 && i < max_list[0])
+                        for (int j = particle_list[ii].list_num[1] - 1; j <= particle_list[ii].list_num[1] + 1; j++)
+                            if (j >= 0 && j < max_list[1])
+                            {
+                                for (int cnt = cells.begin(i, j); cnt < cells.end(i, j); cnt++)
+                                    add(&particle_list[cnt]);
+                                for (int cnt = boundary.cells.begin(i, j); cnt < boundary.cells.end(i, j); cnt++)
+                                    add(&particle_list[cnt]);
+                            }
 
-                    // Update position in x-direction based on half-step
-                    double temp_half_x0 = particle_list[i].prev_x[0] + 0.5 * delta_t * particle_list[i].v[0];
-                    particle_list[i].x[0] = 2 * temp_half_x0 - particle_list[i].prev_x[0];
+            rho_smoothed[ii] = numerator_sum / denominator_sum;
+        }
+    });
 
-                    // if the x-direction position is inside wall, or out of boundary
-                    if (particle_list[i].x[0] < inner_min_x[0] || particle_list[i].x[0] > inner_max_x[0])
-                    {
-                        // return back to previous x-direction possition, reverse the velocity direction to bounce the particle back
-                        particle_list[i].x[0] = particle_list[i].prev_x[0];
-                        particle_list[i].v[0] = -velocity_lost_rate * particle_list[i].prev_v[0];
-                        horizontal_wall = true; // the particle is close to the horizontal wall
-                    }
+    // every particle is smoothed with the densities of the same time level
+#pragma omp parallel for num_threads(num_threads)
+    for (int ii = 0; ii < int(particle_list.size()); ii++)
+        particle_list[ii].rho = rho_smoothed[ii];
+}
 
-                    // Update position in y-direction based on half-step
-                    double temp_half_x1 = particle_list[i].prev_x[1] + 0.5 * delta_t * particle_list[i].v[1];
-                    particle_list[i].x[1] = 2 * temp_half_x1 - particle_list[i].prev_x[1];
-                    if (particle_list[i].x[1] < inner_min_x[1] || particle_list[i].x[1] > inner_max_x[1])
-                    {
-                        // return back to previous y-direction possition, reverse the velocity direction to bounce the particle back
-                        particle_list[i].x[1] = particle_list[i].prev_x[1];
-                        particle_list[i].v[1] = -velocity_lost_rate * particle_list[i].prev_v[1];
-                        vertical_wall = true; // the particle is close to the vertical wall
-                    }
+void SPH_main::euler_particle(int i)
+{
+    SPH_particle& part = particle_list[i];
 
-                    // Update all particles' velocities that are not close to the wall
-                    if (!vertical_wall)
-                    {
-                        double temp_half_v1 = particle_list[i].prev_v[1] + 0.5 * delta_t * particle_list[i].a[1];
-                        particle_list[i].v[1] = 2 * temp_half_v1 - particle_list[i].prev_v[1];
-                    }
-                    if (!horizontal_wall)
-                    {
-                        double temp_half_v0 = particle_list[i].prev_v[0] + 0.5 * delta_t * particle_list[i].a[0];
-                        particle_list[i].v[0] = 2 * temp_half_v0 - particle_list[i].prev_v[0];
-                    }
+    // boundary particles keep their place and zero velocity, only the density and pressure change
+    if (i < boundary.n)
+    {
+        part.rho = part.rho + delta_t * part.D;
+        part.calculate_P();
+        return;
+    }
 
-                }
-                double temp_half_rho = particle_list[i].prev_rho + 0.5 * delta_t * particle_list[i].D;
-                particle_list[i].rho = 2 * temp_half_rho - particle_list[i].prev_rho;
-                particle_list[i].calculate_P();
-                particle_list[i].calc_index();
-            }
+    bool wall[2] = { false, false };
+    for (int k = 0; k != 2; k++)
+    {
+        part.x[k] = part.x[k] + delta_t * part.v[k];
+        if (part.x[k] < inner_min_x[k] || part.x[k] > inner_max_x[k])
+        {
+            part.x[k] = part.x[k] - delta_t * part.v[k];
+            part.v[k] = -velocity_lost_rate * part.v[k];
+            wall[k] = true;
+        }
+
+        if (!wall[k])
+            part.v[k] = part.v[k] + delta_t * part.a[k];
+    }
+    part.rho = part.rho + delta_t * part.D;
+    part.calculate_P();
+    part.calc_index(min_x, h);
+}
+
+void SPH_main::forward_euler(bool smooth, bool stencil)
+{
+    if (pipeline_supported(smooth) && step_pipeline(false, time_step.adaptive))
+        return;
+
+    allocate_to_grid();
+
+    // generally it needs to smooth the density every ten to twenty updates, which is done within the force sweep
+    if (use_verlet)
+        compute_forces_verlet(time_step.adaptive, smooth);
+    else if (use_soa)
+        compute_forces_batched(time_step.adaptive, smooth);
+    else
+        compute_forces(stencil, time_step.adaptive, smooth);
+
+    SPH_phase_timer integration(trace, &SPH_step_record::t_integration);
+
+#pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < int(particle_list.size()); i++)
+        euler_particle(i);
+
+    integration.stop();
+    trace.end_step(delta_t, particle_list.size());
+}
+
+void SPH_main::allocate_previous_state()
+{
+    // the previous state is only needed by this scheme, and only within one step, so it does not follow the sorts
+    for (int k = 0; k < 2; k++)
+    {
+        prev_x[k].resize(particle_list.size());
+        prev_v[k].resize(particle_list.size());
+    }
+    prev_rho.resize(particle_list.size());
+}
+
+void SPH_main::predict_particle(int i)
+{
+    SPH_particle& part = particle_list[i];
+
+    // boundary particles come first, their velocity stays 0 and only the density changes
+    if (i < boundary.n)
+        prev_rho[i] = part.rho;
+
+    // if the particle is not boundary, update postition first, and check if the position is our of grid's boundary.
+    else
+    {
+        // Store previous particle information
+        for (int k = 0; k != 2; k++)
+        {
+            prev_x[k][i] = part.x[k];
+            prev_v[k][i] = part.v[k];
+        }
+        prev_rho[i] = part.rho;
+
+        // Assume all the particals are not close to the wall
+        bool vertical_wall = false, horizontal_wall = false;
+
+        // Update position in x-direction
+        part.x[0] = part.x[0] + 0.5 * delta_t * part.v[0];
+
+        // if the x-direction position is inside wall, or out of boundary
+        if (part.x[0] < inner_min_x[0] || part.x[0] > inner_max_x[0])
+        {
+            // return back to previous x-direction possition, reverse the velocity direction to bounce the particle back
+            part.x[0] = part.x[0] - 0.5 * delta_t * part.v[0];
+            part.v[0] = -velocity_lost_rate * prev_v[0][i];
+            horizontal_wall = true; // the particle is close to the horizontal wall
+        }
+
+        // Update position in y-direction
+        part.x[1] = part.x[1] + 0.5 * delta_t * part.v[1];
+        if (part.x[1] < inner_min_x[1] || part.x[1] > inner_max_x[1])
+        {
+            // return back to previous y-direction possition, reverse the velocity direction to bounce the particle back
+            part.x[1] = part.x[1] - 0.5 * delta_t * part.v[1];
+            part.v[1] = -velocity_lost_rate * prev_v[1][i];
+            vertical_wall = true; // the particle is close to the vertical wall
+        }
+
+        // Update all particles' velocities that are not close to the wall
+        if (!vertical_wall)
+            part.v[1] = part.v[1] + 0.5 * delta_t * part.a[1];
+        if (!horizontal_wall)
+            part.v[0] = part.v[0] + 0.5 * delta_t * part.a[0];
+    }
+
+    // Update density, pressure and particle index using previous time-step result
+    part.rho = part.rho + 0.5 * delta_t * part.D;
+    part.calculate_P();
+    if (i >= boundary.n)
+        part.calc_index(min_x, h);
+}
+
+void SPH_main::correct_particle(int i)
+{
+    SPH_particle& part = particle_list[i];
+
+    // if the particle is not boundary, update postition first, and check if the position is our of grid's boundary.
+    if (i >= boundary.n)
+    {
+        // Assume all the particals are not close to the wall
+        bool vertical_wall = false, horizontal_wall = false;
+
+        // Update position in x-direction based on half-step
+        double temp_half_x0 = prev_x[0][i] + 0.5 * delta_t * part.v[0];
+        part.x[0] = 2 * temp_half_x0 - prev_x[0][i];
+
+        // if the x-direction position is inside wall, or out of boundary
+        if (part.x[0] < inner_min_x[0] || part.x[0] > inner_max_x[0])
+        {
+            // return back to previous x-direction possition, reverse the velocity direction to bounce the particle back
+            part.x[0] = prev_x[0][i];
+            part.v[0] = -velocity_lost_rate * prev_v[0][i];
+            horizontal_wall = true; // the particle is close to the horizontal wall
+        }
+
+        // Update position in y-direction based on half-step
+        double temp_half_x1 = prev_x[1][i] + 0.5 * delta_t * part.v[1];
+        part.x[1] = 2 * temp_half_x1 - prev_x[1][i];
+        if (part.x[1] < inner_min_x[1] || part.x[1] > inner_max_x[1])
+        {
+            // return back to previous y-direction possition, reverse the velocity direction to bounce the particle back
+            part.x[1] = prev_x[1][i];
+            part.v[1] = -velocity_lost_rate * prev_v[1][i];
+            vertical_wall = true; // the particle is close to the vertical wall
+        }
+
+        // Update all particles' velocities that are not close to the wall
+        if (!vertical_wall)
+        {
+            double temp_half_v1 = prev_v[1][i] + 0.5 * delta_t * part.a[1];
+            part.v[1] = 2 * temp_half_v1 - prev_v[1][i];
+        }
+        if (!horizontal_wall)
+        {
+            double temp_half_v0 = prev_v[0][i] + 0.5 * delta_t * part.a[0];
+            part.v[0] = 2 * temp_half_v0 - prev_v[0][i];
         }
+
     }
+    double temp_half_rho = prev_rho[i] + 0.5 * delta_t * part.D;
+    part.rho = 2 * temp_half_rho - prev_rho[i];
+    part.calculate_P();
+    if (i >= boundary.n)
+        part.calc_index(min_x, h);
+}
+
+// predictor corrector scheme which is second-order scheme
+void SPH_main::predictor_corrector(bool smooth, bool change_delta_t, bool stencil)
+{
+    change_delta_t = change_delta_t || time_step.adaptive;
+
+    if (pipeline_supported(smooth) && step_pipeline(true, change_delta_t))
+        return;
+
+    allocate_to_grid();
+
+    // Update and search neighbour, smoothing the density in the same sweep
+    if (use_verlet)
+        compute_forces_verlet(change_delta_t, smooth);
+    else if (use_soa)
+        compute_forces_batched(change_delta_t, smooth);
+    else
+        compute_forces(stencil, change_delta_t, smooth);
+
+    SPH_phase_timer integration(trace, &SPH_step_record::t_integration);
+    allocate_previous_state();
+
+    // The first loop is half step, the second loop is full step
+#pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < int(particle_list.size()); i++)
+        predict_particle(i);
+
+    // Run full-step using half-step results
+#pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < int(particle_list.size()); i++)
+        correct_particle(i);
+
+    integration.stop();
+    trace.end_step(delta_t, particle_list.size());
 }
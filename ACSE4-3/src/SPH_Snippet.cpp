@@ -1,61 +1,198 @@
 #include "../includes/SPH_2D.h"
 #include "../includes/file_writer.h"
+#include "../includes/snapshot_writer.h"
+#include "../includes/SPH_mpi.h"
+#include "../includes/SPH_checkpoint.h"
+#include "../includes/SPH_analytics.h"
+#include "../includes/SPH_geometry.h"
 #include <ctime>
+#include <chrono>
 
 SPH_main domain;
 
-int main(void)
+// rank of this process, only process 0 reads the input and places the particles
+int id = 0;
+
+// wall clock seconds between two checkpoints
+const double checkpoint_interval = 300;
+
+// run "./SPH_2D restart" to continue from the last checkpoint instead of placing the particles again,
+// "./SPH_2D trace.csv" (or trace.json) to write the timings and counters of every step,
+// "./SPH_2D -a analytics.csv" to write the reductions of SPH_analytics every step,
+// "./SPH_2D -s 1000" to write a snapshot of all particles every 1000 steps instead of 50, 0 for none,
+// "./SPH_2D -g geometry.txt" to place the particles of a geometry file (see SPH_geometry.h) instead of the dam break,
+// "./SPH_2D -t 8" to run on 8 OpenMP threads instead of OMP_NUM_THREADS,
+// and "./SPH_2D -T run.traj" to append the snapshots to a compressed trajectory (see SPH_trajectory.h) instead of VTK files
+int main(int argc, char** argv)
 {
+    bool restart = false;
+    string trace_name, analytics_name, geometry_name, trajectory_name;
+    int snapshot_interval = 50;
+    for (int a = 1; a < argc; a++)
+    {
+        if (string(argv[a]) == "restart")
+            restart = true;
+        else if (string(argv[a]) == "-a" && a + 1 < argc)
+            analytics_name = argv[++a];
+        else if (string(argv[a]) == "-s" && a + 1 < argc)
+            snapshot_interval = atoi(argv[++a]);
+        else if (string(argv[a]) == "-g" && a + 1 < argc)
+            geometry_name = argv[++a];
+        else if (string(argv[a]) == "-T" && a + 1 < argc)
+            trajectory_name = argv[++a];
+        else if (string(argv[a]) == "-t" && a + 1 < argc)
+            domain.num_threads = max(atoi(argv[++a]), 1);
+        else
+            trace_name = argv[a];
+    }
+
+#ifdef SPH_USE_MPI
+    MPI_Init(nullptr, nullptr);
+    MPI_Comm_rank(MPI_COMM_WORLD, &id);
+#endif
+
     double h_factor = 1.3;
     double DX;
+    double T_MAX;
+    bool scheme;
 
-    cout << "Input the initial distance between particles (namely dx) : ";
-    cin >> DX;
-    if (cin.fail())
+    if (id == 0 && !restart)
     {
-        cerr << "you input a wrong format of dx! Over!" << endl;
-        exit(0);
+        cout << "Input the initial distance between particles (namely dx) : ";
+        cin >> DX;
+        if (cin.fail())
+        {
+            cerr << "you input a wrong format of dx! Over!" << endl;
+            exit(0);
+        }
+
+        cout << "Input the total time you want to simulate : ";
+        cin >> T_MAX;
+        if (cin.fail())
+        {
+            cerr << "you input a wrong format of total time! Over!" << endl;
+            exit(0);
+        }
     }
 
-    double T_MAX;
-    cout << "Input the total time you want to simulate : ";
-    cin >> T_MAX;
-    if (cin.fail())
+    if (id == 0)
     {
-        cerr << "you input a wrong format of total time! Over!" << endl;
-        exit(0);
+        cout << "Select your time stepping scheme to simulate, \"0\" : Forward Euler, and \"1\" : predictor corrector:\n";
+        cin >> scheme;
+        if (cin.fail())
+        {
+            cerr << "you input a wrong format of scheme number! Over!" << endl;
+            exit(0);
+        }
     }
 
-    bool scheme;
-    cout << "Select your time stepping scheme to simulate, \"0\" : Forward Euler, and \"1\" : predictor corrector:\n";
-    cin >> scheme;
-    if (cin.fail())
+#ifdef SPH_USE_MPI
+    int scheme_num = scheme;
+    MPI_Bcast(&DX, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&T_MAX, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&scheme_num, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    scheme = scheme_num;
+#endif
+
+    // the predictor corrector scheme adapts delta_t every step
+    domain.time_step.adaptive = scheme;
+
+    double time = 0;
+    int cnt = 0;
+
+    // every process saves and restores its own particles
+    string checkpoint_name = "checkpoint.sph";
+#ifdef SPH_USE_MPI
+    checkpoint_name = "checkpoint_" + to_string(id) + ".sph";
+#endif
+
+    if (restart)
     {
-        cerr << "you input a wrong format of scheme number! Over!" << endl;
-        exit(0);
+        if (read_checkpoint(checkpoint_name.c_str(), domain, time, cnt))
+            exit(1);
+        cout << "restarting from iteration " << cnt << ", time " << time << endl;
     }
+    else
+    {
+        //Set simulation parameters
+        domain.set_values(h_factor, DX, T_MAX);
+        cout << domain.h << endl;
+
+        // every process needs the domain of the geometry for the grid
+        SPH_geometry geometry;
+        if (!geometry_name.empty())
+        {
+            if (geometry.read(geometry_name.c_str()))
+                exit(1);
+            geometry.apply_domain(domain);
+        }
 
+        //initialise simulation grid
+        domain.initialise_grid();
 
-    //Set simulation parameters
-    domain.set_values(h_factor, DX, T_MAX);
+        //places initial points
+        if (id == 0)
+        {
+            if (geometry_name.empty())
+                domain.place_points(domain.min_x, domain.max_x);
+            else
+                domain.place_points(geometry, domain.min_x, domain.max_x);
+            write_file("original.vtp", &domain.particle_list);
+        }
+    }
 
-    //initialise simulation grid
-    domain.initialise_grid();
+#ifdef SPH_USE_MPI
+    // balance the cells between the processes, the particles are sent from process 0 in the first step
+    SPH_mpi_domain mpi(&domain);
+    mpi.partition();
+#endif
 
-    //places initial points - will need to be modified to include boundary points and the specifics of where the fluid is in the domain
-    domain.place_points(domain.min_x, domain.max_x);
+    if (!trace_name.empty())
+    {
+#ifdef SPH_USE_MPI
+        trace_name = to_string(id) + "_" + trace_name;
+#endif
+        if (domain.trace.open(trace_name))
+            exit(1);
+    }
 
-    write_file("original.vtp", &domain.particle_list);
+    SPH_analytics analytics;
+    if (!analytics_name.empty())
+    {
+#ifdef SPH_USE_MPI
+        // every process takes part in the reductions, process 0 writes them
+        analytics.reduce_sum = SPH_mpi_domain::global_sum;
+        analytics.reduce_max = SPH_mpi_domain::global_max;
+        analytics.enabled = true;
+        if (id == 0)
+#endif
+        if (analytics.open(analytics_name, restart))
+            exit(1);
+    }
 
     //needs to be called for each time step
     domain.allocate_to_grid();
 
     bool smooth;
-    double time = 0;
-    int cnt = 0;
+
+    // snapshots are written by a background thread, the loop only waits when it is 2 frames behind
+    SPH_snapshot_writer writer(2);
+
+    // every process keeps the trajectory of its own particles
+    SPH_trajectory_writer trajectory;
+    if (!trajectory_name.empty())
+    {
+#ifdef SPH_USE_MPI
+        trajectory_name = to_string(id) + "_" + trajectory_name;
+#endif
+        if (trajectory.open(trajectory_name, domain, restart))
+            exit(1);
+        writer.trajectory = &trajectory;
+    }
 
     clock_t start, end;
     start = clock();
+    auto last_checkpoint = chrono::steady_clock::now();
     while (time < domain.t_max)
     {
         smooth = false;
@@ -63,27 +200,59 @@ int main(void)
         if (cnt % 20 == 0)
             smooth = true;
 
+#ifdef SPH_USE_MPI
+        // rebalance every 500 steps, the particles migrate at the start of the next step
+        if (cnt % 500 == 499)
+            mpi.partition();
+
+        mpi.step(smooth, scheme, true);
+#else
+        // the coloured stencil sweep runs on all threads and smooths within the sweep
         if (scheme)
-            domain.predictor_corrector(smooth);
+            domain.predictor_corrector(smooth, false, true);
         else
-            domain.forward_euler(smooth);
+            domain.forward_euler(smooth, true);
+#endif
 
-        if ( cnt % 50 == 0 )
+        if ( snapshot_interval > 0 && cnt % snapshot_interval == 0 )
         {
             cout << "iteration " << cnt << endl;
-            string name = "example_" + to_string( (int) ( cnt / 50 ) ) + ".vtp";
+            string name = "example_" + to_string( (int) ( cnt / snapshot_interval ) ) + ".vtp";
+#ifdef SPH_USE_MPI
+            // every process writes its own particles
+            name = "example_" + to_string( (int) ( cnt / snapshot_interval ) ) + "_" + to_string(id) + ".vtp";
+#endif
             cout << name << endl;
             cout << "time is : " << time << endl;
-            const char* cstr = name.c_str();
-            write_file(cstr, &domain.particle_list);
+            writer.submit(name, domain.particle_list, time, cnt);
         }
 
         cnt++;
         time += domain.delta_t;
+
+        analytics.record(domain, time, cnt);
+
+        // process 0 decides, so that all checkpoints hold the same step
+        int checkpoint = chrono::duration<double>(chrono::steady_clock::now() - last_checkpoint).count() > checkpoint_interval;
+#ifdef SPH_USE_MPI
+        MPI_Bcast(&checkpoint, 1, MPI_INT, 0, MPI_COMM_WORLD);
+#endif
+        if (checkpoint)
+        {
+            write_checkpoint(checkpoint_name.c_str(), domain, time, cnt);
+            last_checkpoint = chrono::steady_clock::now();
+        }
     }
+    writer.finish();
+    trajectory.close();
     cout << "final iteration is " << cnt << endl;
+    cout << "snapshots written : " << writer.frames_written << " (" << writer.bytes_written << " bytes), steps waiting for the writer : " << writer.stalls << endl;
     end = clock();
     cout << "all time consuming is : " << (end - start) / (double)CLOCKS_PER_SEC << " seconds" << endl;
 
+#ifdef SPH_USE_MPI
+    MPI_Finalize();
+#endif
+
     return 0;
 }
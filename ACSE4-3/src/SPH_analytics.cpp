@@ -0,0 +1,130 @@
+#include <iomanip>
+#include <sstream>
+#include "../includes/SPH_analytics.h"
+#include "../includes/SPH_2D.h"
+
+SPH_analytics::~SPH_analytics()
+{
+    close();
+}
+
+int SPH_analytics::open(const string& filename, bool append)
+{
+    close();
+
+    file.open(filename, append ? ios::app : ios::out);
+    if (!file)
+    {
+        cerr << "could not open analytics file " << filename << endl;
+        return 1;
+    }
+
+    if (!append)
+    {
+        file << "step,time";
+        if (quantities & SPH_KINETIC_ENERGY)
+            file << ",kinetic_energy";
+        if (quantities & SPH_MAX_VELOCITY)
+            file << ",max_velocity";
+        if (quantities & SPH_SURGE_FRONT)
+            file << ",surge_front";
+        if (quantities & SPH_WALL_PRESSURE)
+            file << ",wall_force,wall_max_pressure";
+
+        // every bin is named after its upper edge
+        if (quantities & SPH_DENSITY_ERROR)
+            for (int b = 0; b < bins; b++)
+            {
+                ostringstream edge;
+                edge << max_error * (b + 1) / bins;
+                file << ",rho_error_" << (b + 1 < bins ? edge.str() : string("max"));
+            }
+        file << '\n';
+    }
+
+    file << setprecision(10);
+    enabled = true;
+    return 0;
+}
+
+void SPH_analytics::close()
+{
+    if (file.is_open())
+        file.close();
+}
+
+void SPH_analytics::record(const SPH_main& domain, double time, int step)
+{
+    if (!enabled || step % interval != 0)
+        return;
+
+    const vector<SPH_particle>& particle_list = domain.particle_list;
+    const double mass = domain.dx * domain.dx * rho0;
+    const double wall = domain.inner_max_x[0];
+
+    double kinetic = 0, force = 0, v2_max = 0, front = domain.inner_min_x[0], p_max = 0;
+    density_error.assign(bins, 0);
+    double* hist = density_error.data();
+    int n_bins = bins;
+
+    // one pass computes every quantity, the selection only decides what is written
+#pragma omp parallel for reduction(+:kinetic, force) reduction(max:v2_max, front, p_max) reduction(+:hist[:n_bins]) num_threads(domain.num_threads)
+    for (int i = 0; i < int(particle_list.size()); i++)
+    {
+        const SPH_particle& part = particle_list[i];
+        if (part.ghost)
+            continue;
+
+        if (part.boundary_status)
+        {
+            if (part.x[0] >= wall && part.x[0] < wall + domain.dx)
+            {
+                force += part.P * domain.dx;
+                p_max = max(p_max, part.P);
+            }
+            continue;
+        }
+
+        double v2 = part.v[0] * part.v[0] + part.v[1] * part.v[1];
+        kinetic += 0.5 * mass * v2;
+        v2_max = max(v2_max, v2);
+        if (part.x[1] > front_height)
+            front = max(front, part.x[0]);
+
+        int b = int(fabs(part.rho - rho0) / rho0 / max_error * n_bins);
+        hist[min(b, n_bins - 1)] += 1;
+    }
+
+    double sums[2] = { kinetic, force };
+    double maxima[3] = { v2_max, front, p_max };
+    if (reduce_sum)
+    {
+        reduce_sum(sums, 2);
+        reduce_sum(hist, n_bins);
+    }
+    if (reduce_max)
+        reduce_max(maxima, 3);
+
+    kinetic_energy = sums[0];
+    wall_force = sums[1];
+    max_velocity = sqrt(maxima[0]);
+    surge_front = maxima[1];
+    wall_max_pressure = maxima[2];
+
+    if (!file.is_open())
+        return;
+
+    file << step << ',' << time;
+    if (quantities & SPH_KINETIC_ENERGY)
+        file << ',' << kinetic_energy;
+    if (quantities & SPH_MAX_VELOCITY)
+        file << ',' << max_velocity;
+    if (quantities & SPH_SURGE_FRONT)
+        file << ',' << surge_front;
+    if (quantities & SPH_WALL_PRESSURE)
+        file << ',' << wall_force << ',' << wall_max_pressure;
+    if (quantities & SPH_DENSITY_ERROR)
+        for (int b = 0; b < bins; b++)
+            file << ',' << long(density_error[b]);
+    file << '\n';
+}
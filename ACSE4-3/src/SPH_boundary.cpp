@@ -0,0 +1,58 @@
+#include "../includes/SPH_boundary.h"
+#include "../includes/SPH_2D.h"
+
+void SPH_boundary_set::build(vector<SPH_particle>& particle_list, int nx, int ny, double h, int num_threads, SPH_cell_order order, SPH_cell_storage storage)
+{
+    n = int(stable_partition(particle_list.begin(), particle_list.end(),
+        [](const SPH_particle& part) { return part.boundary_status; }) - particle_list.begin());
+
+    cells.initialise(nx, ny, order, storage);
+    cells.build(particle_list, 0, n);
+
+    // visit the boundary particles within 2h of boundary particle i, calling found(j, dist)
+    auto for_each_pair = [&](int i, auto found)
+    {
+        const SPH_particle& part = particle_list[i];
+        for (int ci = max(part.list_num[0] - 1, 0); ci <= min(part.list_num[0] + 1, nx - 1); ci++)
+            for (int cj = max(part.list_num[1] - 1, 0); cj <= min(part.list_num[1] + 1, ny - 1); cj++)
+                for (int j = cells.begin(ci, cj); j < cells.end(ci, cj); j++)
+                {
+                    double dx = part.x[0] - particle_list[j].x[0];
+                    double dy = part.x[1] - particle_list[j].x[1];
+                    double r = sqrt(dx * dx + dy * dy);
+                    if (j != i && r < 2.0 * h)
+                        found(j, r);
+                }
+    };
+
+    // the same two passes as the Verlet lists, counting first
+    start.resize(n + 1);
+
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads)
+    for (int i = 0; i < n; i++)
+    {
+        int count = 0;
+        for_each_pair(i, [&count](int, double) { count++; });
+        start[i + 1] = count;
+    }
+
+    start[0] = 0;
+    for (int i = 0; i < n; i++)
+        start[i + 1] += start[i];
+
+    neighbours.resize(start[n]);
+    dist.resize(start[n]);
+
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads)
+    for (int i = 0; i < n; i++)
+    {
+        int pos = start[i];
+        for_each_pair(i, [&](int j, double r)
+        {
+            neighbours[pos] = j;
+            dist[pos++] = r;
+        });
+    }
+
+    binned = true;
+}
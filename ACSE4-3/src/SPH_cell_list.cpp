@@ -0,0 +1,334 @@
+#include "../includes/SPH_cell_list.h"
+#include "../includes/SPH_2D.h"
+
+// index of cell (i, j) along the Hilbert curve filling a side x side square, side a power of 2
+static long hilbert_index(long side, long i, long j)
+{
+    long d = 0;
+    for (long s = side / 2; s > 0; s /= 2)
+    {
+        long ri = (i & s) > 0, rj = (j & s) > 0;
+        d += s * s * ((3 * ri) ^ rj);
+
+        // rotate the quadrant so that the curve enters and leaves it at the right corners
+        if (rj == 0)
+        {
+            if (ri == 1)
+            {
+                i = side - 1 - i;
+                j = side - 1 - j;
+            }
+            swap(i, j);
+        }
+    }
+    return d;
+}
+
+// index of cell (i, j) along the Morton curve, the bits of i and j interleaved
+static long morton_index(long i, long j)
+{
+    long d = 0;
+    for (int bit = 0; bit < 31; bit++)
+        d |= ((i >> bit & 1L) << (2 * bit + 1)) | ((j >> bit & 1L) << (2 * bit));
+    return d;
+}
+
+void SPH_cell_list::initialise(int nx, int ny, SPH_cell_order cell_order, SPH_cell_storage cell_storage)
+{
+    max_list[0] = nx;
+    max_list[1] = ny;
+    order = cell_order;
+    storage = cell_storage;
+
+    // the curves run over square tiles of cells and are defined on a power of 2 square of tiles,
+    // the tiles outside the grid are skipped
+    side = 1;
+    while (side * SPH_CELL_TILE < nx || side * SPH_CELL_TILE < ny)
+        side *= 2;
+
+    // the sparse storage never needs an array over the whole grid
+    sparse = storage == SPH_CELLS_SPARSE;
+    occupied = 0;
+    occupied_cell.clear();
+    occupied_start.assign(1, 0);
+    reset_hash(0);
+
+    if (sparse)
+    {
+        vector<int>().swap(rank);
+        vector<int>().swap(cell_start);
+        vector<int>().swap(cell_count);
+    }
+    else
+    {
+        rank.clear();
+        allocate_dense();
+    }
+}
+
+long SPH_cell_list::layout_key(int i, int j) const
+{
+    if (order == SPH_ORDER_ROWS)
+        return cell_id(i, j);
+
+    // within a tile the cells are in row order, so most column segments of three cells stay contiguous
+    long ti = i / SPH_CELL_TILE, tj = j / SPH_CELL_TILE;
+    long tile = order == SPH_ORDER_HILBERT ? hilbert_index(side, ti, tj) : morton_index(ti, tj);
+    return tile * SPH_CELL_TILE * SPH_CELL_TILE + (i % SPH_CELL_TILE) * SPH_CELL_TILE + j % SPH_CELL_TILE;
+}
+
+void SPH_cell_list::allocate_dense()
+{
+    cell_start.assign(n_cells() + 1, 0);
+    cell_count.assign(n_cells(), 0);
+
+    if (int(rank.size()) == n_cells())
+        return;
+
+    vector<long> key(n_cells());
+    for (int i = 0; i < max_list[0]; i++)
+        for (int j = 0; j < max_list[1]; j++)
+            key[cell_id(i, j)] = layout_key(i, j);
+
+    vector<int> cell(n_cells());
+    for (int c = 0; c < n_cells(); c++)
+        cell[c] = c;
+    sort(cell.begin(), cell.end(), [&key](int a, int b) { return key[a] < key[b]; });
+
+    rank.resize(n_cells());
+    for (int r = 0; r < n_cells(); r++)
+        rank[cell[r]] = r;
+}
+
+void SPH_cell_list::reset_hash(int cells)
+{
+    // at most half full, so a probe sequence ends after a few slots
+    int bits = 1;
+    while ((1L << bits) < 2L * cells)
+        bits++;
+
+    hash_mask = (1u << bits) - 1;
+    hash_shift = 32 - bits;
+    hash_cell.assign(size_t(hash_mask) + 1, -1);
+    hash_index.resize(size_t(hash_mask) + 1);
+}
+
+void SPH_cell_list::build(vector<SPH_particle>& particle_list, int first, int last)
+{
+    if (last < 0)
+        last = int(particle_list.size());
+
+    sorted.resize(particle_list.size());
+
+    // the particles outside the range keep their place
+    copy(particle_list.begin(), particle_list.begin() + first, sorted.begin());
+    copy(particle_list.begin() + last, particle_list.end(), sorted.begin() + last);
+
+    if (sparse)
+        build_sparse(particle_list, first, last);
+    else
+        build_dense(particle_list, first, last);
+
+    // the old list becomes the sorting buffer of the next build
+    particle_list.swap(sorted);
+
+    // the next builds use the storage that suits the occupancy of this one, with some hysteresis
+    if (storage == SPH_CELLS_AUTO)
+    {
+        double occupancy = double(occupied) / max(n_cells(), 1);
+        if (!sparse && occupancy < sparse_occupancy)
+            to_sparse();
+        else if (sparse && occupancy > 2 * sparse_occupancy)
+            to_dense();
+    }
+}
+
+void SPH_cell_list::build_dense(vector<SPH_particle>& particle_list, int first, int last)
+{
+    int n_c = n_cells();
+
+    // count the particles of every cell
+    fill(cell_count.begin(), cell_count.end(), 0);
+    for (int i = first; i < last; i++)
+        cell_count[rank[cell_id(particle_list[i].list_num[0], particle_list[i].list_num[1])]]++;
+
+    // exclusive prefix sum gives the first particle of every cell
+    occupied = 0;
+    cell_start[0] = first;
+    for (int c = 0; c < n_c; c++)
+    {
+        cell_start[c + 1] = cell_start[c] + cell_count[c];
+        occupied += cell_count[c] > 0;
+    }
+
+    // scatter the particles to their cells, using cell_count as the insertion cursor
+    for (int c = 0; c < n_c; c++)
+        cell_count[c] = cell_start[c];
+
+    for (int i = first; i < last; i++)
+    {
+        const SPH_particle& p = particle_list[i];
+        int c = rank[cell_id(p.list_num[0], p.list_num[1])];
+        int dst = cell_count[c]++;
+        sorted[dst] = p;
+
+        // index of the particle in its cell, which is used for stencil neighbour particles finding algorithm
+        sorted[dst].grid_index = dst - cell_start[c];
+    }
+
+    for (int c = 0; c < n_c; c++)
+        cell_count[c] = cell_start[c + 1] - cell_start[c];
+}
+
+void SPH_cell_list::build_sparse(vector<SPH_particle>& particle_list, int first, int last)
+{
+    // sized for the occupancy of the last build, and grown when more cells are met
+    reset_hash(max(occupied, 64));
+    met_cell.clear();
+    hash_slots.clear();
+    cell_count.clear();
+    particle_cell.resize(last - first);
+
+    // find the occupied cells, numbered in the order they are met, and count their particles
+    for (int i = first; i < last; i++)
+    {
+        int c = cell_id(particle_list[i].list_num[0], particle_list[i].list_num[1]);
+        unsigned slot = hash_slot(c);
+        while (hash_cell[slot] >= 0 && hash_cell[slot] != c)
+            slot = (slot + 1) & hash_mask;
+
+        if (hash_cell[slot] < 0)
+        {
+            hash_cell[slot] = c;
+            hash_index[slot] = int(met_cell.size());
+            met_cell.push_back(c);
+            hash_slots.push_back(int(slot));
+            cell_count.push_back(0);
+
+            // keep the hash at most half full
+            if (2 * met_cell.size() > hash_mask + 1)
+            {
+                reset_hash(2 * int(met_cell.size()));
+                for (int m = 0; m < int(met_cell.size()); m++)
+                {
+                    unsigned s = hash_slot(met_cell[m]);
+                    while (hash_cell[s] >= 0)
+                        s = (s + 1) & hash_mask;
+                    hash_cell[s] = met_cell[m];
+                    hash_index[s] = m;
+                    hash_slots[m] = int(s);
+                }
+                slot = hash_slots.back();
+            }
+        }
+        particle_cell[i - first] = hash_index[slot];
+        cell_count[hash_index[slot]]++;
+    }
+    occupied = int(met_cell.size());
+
+    // put the occupied cells in layout order
+    cell_position.resize(occupied);
+    for (int m = 0; m < occupied; m++)
+        cell_position[m] = m;
+    sort(cell_position.begin(), cell_position.end(), [this](int a, int b)
+    {
+        return layout_key(met_cell[a] / max_list[1], met_cell[a] % max_list[1])
+             < layout_key(met_cell[b] / max_list[1], met_cell[b] % max_list[1]);
+    });
+
+    // exclusive prefix sum in layout order, and the hash points to the layout position from now on
+    occupied_cell.resize(occupied);
+    occupied_start.resize(occupied + 1);
+    occupied_start[0] = first;
+    for (int k = 0; k < occupied; k++)
+    {
+        int m = cell_position[k];
+        occupied_cell[k] = met_cell[m];
+        occupied_start[k + 1] = occupied_start[k] + cell_count[m];
+        hash_index[hash_slots[m]] = k;
+    }
+
+    // scatter the particles to their cells, using cell_count as the insertion cursor
+    for (int k = 0; k < occupied; k++)
+        cell_count[k] = occupied_start[k];
+
+    for (int i = first; i < last; i++)
+    {
+        int k = hash_index[hash_slots[particle_cell[i - first]]];
+        int dst = cell_count[k]++;
+        sorted[dst] = particle_list[i];
+        sorted[dst].grid_index = dst - occupied_start[k];
+    }
+
+    for (int k = 0; k < occupied; k++)
+        cell_count[k] = occupied_start[k + 1] - occupied_start[k];
+}
+
+void SPH_cell_list::to_sparse()
+{
+    // the occupied cells of the last build, already in layout order
+    occupied_cell.clear();
+    occupied_start.assign(1, cell_start[0]);
+    vector<int> counts;
+    vector<int> cell_of_rank(n_cells());
+    for (int c = 0; c < n_cells(); c++)
+        cell_of_rank[rank[c]] = c;
+
+    for (int r = 0; r < n_cells(); r++)
+        if (cell_count[r] > 0)
+        {
+            occupied_cell.push_back(cell_of_rank[r]);
+            occupied_start.push_back(cell_start[r + 1]);
+            counts.push_back(cell_count[r]);
+        }
+
+    reset_hash(occupied);
+    for (int k = 0; k < occupied; k++)
+    {
+        unsigned slot = hash_slot(occupied_cell[k]);
+        while (hash_cell[slot] >= 0)
+            slot = (slot + 1) & hash_mask;
+        hash_cell[slot] = occupied_cell[k];
+        hash_index[slot] = k;
+    }
+
+    cell_count.swap(counts);
+    vector<int>().swap(rank);
+    vector<int>().swap(cell_start);
+    sparse = true;
+}
+
+void SPH_cell_list::to_dense()
+{
+    vector<int> counts;
+    counts.swap(cell_count);
+    allocate_dense();
+
+    // the empty cells start where the next occupied cell in layout order starts
+    int first = occupied_start[0];
+    for (int k = 0; k < occupied; k++)
+        cell_count[rank[occupied_cell[k]]] = counts[k];
+    cell_start[0] = first;
+    for (int c = 0; c < n_cells(); c++)
+        cell_start[c + 1] = cell_start[c] + cell_count[c];
+
+    vector<int>().swap(occupied_cell);
+    occupied_start.assign(1, first);
+    reset_hash(0);
+    sparse = false;
+}
+
+int SPH_cell_list::max_count() const
+{
+    int largest = 0;
+    for (int count : cell_count)
+        largest = max(largest, count);
+    return largest;
+}
+
+size_t SPH_cell_list::memory() const
+{
+    size_t ints = rank.size() + cell_start.size() + cell_count.size() + occupied_cell.size() + occupied_start.size()
+                + hash_cell.size() + hash_index.size();
+    return ints * sizeof(int);
+}
@@ -0,0 +1,173 @@
+#include <cstring>
+#include <cstdio>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../includes/SPH_checkpoint.h"
+
+static_assert(std::is_trivially_copyable<SPH_particle>::value, "particles are copied byte for byte into the checkpoint");
+
+static const char checkpoint_magic[8] = { 'S', 'P', 'H', 'C', 'K', 'P', 'T', '\0' };
+
+// the particles start on a cache line
+static const uint64_t checkpoint_particle_offset = (sizeof(SPH_checkpoint_header) + 63) / 64 * 64;
+
+int write_checkpoint(const char* filename, const SPH_main& domain, double time, int iteration)
+{
+    SPH_checkpoint_header header;
+    memset(&header, 0, sizeof(header));
+
+    memcpy(header.magic, checkpoint_magic, sizeof(header.magic));
+    header.version = SPH_CHECKPOINT_VERSION;
+    header.particle_size = sizeof(SPH_particle);
+    header.particle_offset = checkpoint_particle_offset;
+    header.n_particles = domain.particle_list.size();
+
+    header.time = time;
+    header.iteration = iteration;
+    header.kernel = domain.kernel;
+    header.tabulate_kernel = domain.tabulate_kernel;
+
+    header.delta_t = domain.delta_t;
+    header.dt_cfl = domain.dt_cfl;
+    header.dt_f = domain.dt_f;
+    header.dt_a = domain.dt_a;
+    header.t_max = domain.t_max;
+    header.sub_step = int32_t(domain.sub_step);
+
+    header.h = domain.h;
+    header.h_fac = domain.h_fac;
+    header.dx = domain.dx;
+    for (int k = 0; k < 2; k++)
+    {
+        header.min_x[k] = domain.min_x[k];
+        header.max_x[k] = domain.max_x[k];
+        header.inner_min_x[k] = domain.inner_min_x[k];
+        header.inner_max_x[k] = domain.inner_max_x[k];
+        header.max_list[k] = domain.max_list[k];
+    }
+
+    size_t particle_bytes = header.n_particles * sizeof(SPH_particle);
+    size_t size = header.particle_offset + particle_bytes;
+
+    string tmp_name = string(filename) + ".tmp";
+    int fd = open(tmp_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        cerr << "could not create checkpoint " << tmp_name << endl;
+        return 1;
+    }
+
+    if (ftruncate(fd, size) != 0)
+    {
+        cerr << "could not allocate " << size << " bytes for checkpoint " << tmp_name << endl;
+        close(fd);
+        return 1;
+    }
+
+    void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        cerr << "could not map checkpoint " << tmp_name << endl;
+        return 1;
+    }
+
+    // the kernel writes the dirty pages back, the run continues as soon as the copy is done
+    char* data = static_cast<char*>(map);
+    memcpy(data, &header, sizeof(header));
+    if (particle_bytes > 0)
+        memcpy(data + header.particle_offset, domain.particle_list.data(), particle_bytes);
+    munmap(map, size);
+
+    if (rename(tmp_name.c_str(), filename) != 0)
+    {
+        cerr << "could not rename " << tmp_name << " to " << filename << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+int read_checkpoint(const char* filename, SPH_main& domain, double& time, int& iteration)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        cerr << "could not open checkpoint " << filename << endl;
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(SPH_checkpoint_header))
+    {
+        cerr << filename << " is not a checkpoint" << endl;
+        close(fd);
+        return 1;
+    }
+
+    size_t size = st.st_size;
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        cerr << "could not map checkpoint " << filename << endl;
+        return 1;
+    }
+
+    const char* data = static_cast<const char*>(map);
+    SPH_checkpoint_header header;
+    memcpy(&header, data, sizeof(header));
+
+    if (memcmp(header.magic, checkpoint_magic, sizeof(header.magic)) != 0
+        || header.version != SPH_CHECKPOINT_VERSION
+        || header.particle_size != int32_t(sizeof(SPH_particle))
+        || header.particle_offset + header.n_particles * sizeof(SPH_particle) != size)
+    {
+        cerr << filename << " was written by an incompatible version or is truncated" << endl;
+        munmap(map, size);
+        return 1;
+    }
+
+    time = header.time;
+    iteration = header.iteration;
+    domain.kernel = SPH_kernel_type(header.kernel);
+    domain.tabulate_kernel = header.tabulate_kernel;
+
+    domain.delta_t = header.delta_t;
+    domain.dt_cfl = header.dt_cfl;
+    domain.dt_f = header.dt_f;
+    domain.dt_a = header.dt_a;
+    domain.t_max = header.t_max;
+    domain.sub_step = header.sub_step;
+
+    domain.h = header.h;
+    domain.h_fac = header.h_fac;
+    domain.dx = header.dx;
+    domain.verlet.skin = 0.2 * domain.h;
+    for (int k = 0; k < 2; k++)
+    {
+        domain.min_x[k] = header.min_x[k];
+        domain.max_x[k] = header.max_x[k];
+        domain.inner_min_x[k] = header.inner_min_x[k];
+        domain.inner_max_x[k] = header.inner_max_x[k];
+        domain.max_list[k] = header.max_list[k];
+    }
+    domain.cells.initialise(domain.max_list[0], domain.max_list[1], domain.cell_order, domain.cell_storage);
+
+    // the particles are copied straight out of the mapping, nothing is parsed
+    const SPH_particle* particles = reinterpret_cast<const SPH_particle*>(data + header.particle_offset);
+    domain.particle_list.assign(particles, particles + header.n_particles);
+    munmap(map, size);
+
+    // the Verlet lists and the boundary set refer to the particles before the restart
+    domain.verlet.x0.clear();
+    domain.boundary.binned = false;
+
+    domain.trace.step = iteration;
+    domain.trace.time = time;
+
+    return 0;
+}
@@ -0,0 +1,215 @@
+#include <fstream>
+#include <sstream>
+#include "../includes/SPH_geometry.h"
+#include "../includes/SPH_2D.h"
+
+bool SPH_shape::covers(const double* x, double dx) const
+{
+    double margin = layers * dx;
+    if (x[0] < lower[0] - margin || x[0] > upper[0] + margin || x[1] < lower[1] - margin || x[1] > upper[1] + margin)
+        return false;
+
+    if (box)
+    {
+        // the bounding box test above is the whole wall of a box
+        bool inside = x[0] > lower[0] && x[0] < upper[0] && x[1] > lower[1] && x[1] < upper[1];
+        return layers == 0 ? inside : !inside;
+    }
+
+    // crossings of a ray towards +x with the edges, and the distance to the nearest edge
+    bool inside = false;
+    double dist2 = margin * margin + 1;
+    int n = int(vertices.size() / 2);
+    for (int a = 0, b = n - 1; a < n; b = a++)
+    {
+        const double* p = &vertices[2 * a];
+        const double* q = &vertices[2 * b];
+        if ((p[1] > x[1]) != (q[1] > x[1]) && x[0] < p[0] + (x[1] - p[1]) * (q[0] - p[0]) / (q[1] - p[1]))
+            inside = !inside;
+
+        double ex = q[0] - p[0], ey = q[1] - p[1];
+        double t = ex * ex + ey * ey > 0 ? ((x[0] - p[0]) * ex + (x[1] - p[1]) * ey) / (ex * ex + ey * ey) : 0;
+        t = min(max(t, 0.0), 1.0);
+        double rx = x[0] - p[0] - t * ex, ry = x[1] - p[1] - t * ey;
+        dist2 = min(dist2, rx * rx + ry * ry);
+    }
+
+    // points on an edge are outside, as for a box
+    if (dist2 == 0)
+        inside = false;
+
+    if (layers == 0)
+        return inside;
+    return !inside && dist2 <= margin * margin;
+}
+
+SPH_geometry SPH_geometry::dam_break(int layers)
+{
+    SPH_geometry geometry;
+    auto add = [&geometry](SPH_material material, double x0, double y0, double x1, double y1, int layers)
+    {
+        SPH_shape shape;
+        shape.material = material;
+        shape.lower[0] = x0;
+        shape.lower[1] = y0;
+        shape.upper[0] = x1;
+        shape.upper[1] = y1;
+        shape.layers = layers;
+        geometry.shapes.push_back(shape);
+    };
+
+    // walls around the tank, a water column of 3 x 5 and a layer of 2 m ahead of it
+    add(SPH_BOUNDARY, 0, 0, 20, 10, layers);
+    add(SPH_FLUID, 0, 0, 20, 10, 0);
+    add(SPH_EMPTY, 0, 5, 20, 10, 0);
+    add(SPH_EMPTY, 3, 2, 20, 5, 0);
+    return geometry;
+}
+
+int SPH_geometry::read(const char* filename)
+{
+    ifstream fs(filename);
+    if (!fs)
+    {
+        cerr << "could not open geometry file " << filename << endl;
+        return 1;
+    }
+
+    shapes.clear();
+    string line;
+    int line_number = 0;
+    while (getline(fs, line))
+    {
+        line_number++;
+        istringstream is(line.substr(0, line.find('#')));
+        string word, kind;
+        if (!(is >> word))
+            continue;
+
+        bool ok = true;
+        if (word == "domain")
+            ok = bool(is >> domain_min[0] >> domain_min[1] >> domain_max[0] >> domain_max[1])
+                && domain_min[0] < domain_max[0] && domain_min[1] < domain_max[1];
+        else
+        {
+            SPH_shape shape;
+            if (word == "fluid")
+                shape.material = SPH_FLUID;
+            else if (word == "boundary")
+                shape.material = SPH_BOUNDARY;
+            else if (word == "empty")
+                shape.material = SPH_EMPTY;
+            else
+                ok = false;
+
+            if (ok && (is >> kind) && kind == "box")
+                ok = bool(is >> shape.lower[0] >> shape.lower[1] >> shape.upper[0] >> shape.upper[1])
+                    && shape.lower[0] < shape.upper[0] && shape.lower[1] < shape.upper[1];
+            else if (ok && kind == "polygon")
+            {
+                int n = 0;
+                ok = (is >> n) && n >= 3;
+                shape.box = false;
+                shape.vertices.resize(2 * max(n, 0));
+                for (int k = 0; ok && k < 2 * n; k++)
+                    ok = bool(is >> shape.vertices[k]);
+                for (int d = 0; ok && d < 2; d++)
+                {
+                    shape.lower[d] = shape.upper[d] = shape.vertices[d];
+                    for (int k = 1; k < n; k++)
+                    {
+                        shape.lower[d] = min(shape.lower[d], shape.vertices[2 * k + d]);
+                        shape.upper[d] = max(shape.upper[d], shape.vertices[2 * k + d]);
+                    }
+                }
+            }
+            else
+                ok = false;
+
+            string option;
+            if (ok && (is >> option))
+                ok = option == "layers" && (is >> shape.layers) && shape.layers > 0;
+
+            if (ok)
+                shapes.push_back(shape);
+        }
+
+        string rest;
+        if (!ok || (is >> rest))
+        {
+            cerr << filename << ":" << line_number << ": could not read \"" << line << "\"" << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void SPH_geometry::apply_domain(SPH_main& domain) const
+{
+    for (int i = 0; i < 2; i++)
+    {
+        domain.inner_min_x[i] = domain.min_x[i] = domain_min[i];
+        domain.inner_max_x[i] = domain.max_x[i] = domain_max[i];
+    }
+}
+
+long SPH_geometry::rasterise(vector<SPH_particle>& particle_list, const double* min, const double* max, double dx,
+    const double* grid_min, double h, int num_threads) const
+{
+    // the coordinates are summed up as the original loops did, so the same points are placed
+    vector<double> lattice[2];
+    for (int i = 0; i < 2; i++)
+        for (double x = min[i]; x <= max[i]; x += dx)
+            lattice[i].push_back(x);
+
+    const int nx = int(lattice[0].size()), ny = int(lattice[1].size());
+    vector<unsigned char> material(size_t(nx) * ny);
+    vector<long> offset(nx + 1, 0);
+
+    // classify every point, the last shape covering it decides
+#pragma omp parallel for schedule(dynamic, 16) num_threads(num_threads)
+    for (int i = 0; i < nx; i++)
+    {
+        long count = 0;
+        for (int j = 0; j < ny; j++)
+        {
+            double x[2] = { lattice[0][i], lattice[1][j] };
+            unsigned char found = SPH_EMPTY;
+            for (int s = int(shapes.size()) - 1; s >= 0; s--)
+                if (shapes[s].covers(x, dx))
+                {
+                    found = shapes[s].material;
+                    break;
+                }
+            material[size_t(i) * ny + j] = found;
+            count += found != SPH_EMPTY;
+        }
+        offset[i + 1] = count;
+    }
+
+    offset[0] = particle_list.size();
+    for (int i = 0; i < nx; i++)
+        offset[i + 1] += offset[i];
+    particle_list.resize(offset[nx]);
+
+#pragma omp parallel for schedule(dynamic, 16) num_threads(num_threads)
+    for (int i = 0; i < nx; i++)
+    {
+        long k = offset[i];
+        for (int j = 0; j < ny; j++)
+        {
+            unsigned char found = material[size_t(i) * ny + j];
+            if (found == SPH_EMPTY)
+                continue;
+
+            SPH_particle& particle = particle_list[k];
+            particle.id = int(k++);
+            particle.x[0] = lattice[0][i];
+            particle.x[1] = lattice[1][j];
+            particle.boundary_status = found == SPH_BOUNDARY;
+            particle.calc_index(grid_min, h);
+        }
+    }
+
+    return offset[nx] - offset[0];
+}
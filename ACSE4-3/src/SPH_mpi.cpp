@@ -0,0 +1,290 @@
+#ifdef SPH_USE_MPI
+#include "../includes/SPH_mpi.h"
+
+MPI_Datatype SPH_mpi_domain::MPI_Particle;
+
+SPH_mpi_domain::SPH_mpi_domain(SPH_main* main_domain)
+{
+    MPI_Comm_rank(MPI_COMM_WORLD, &id);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    domain = main_domain;
+    domain->time_step.reduce_min = global_min;
+
+    buildMPIType();
+
+    // until partition is called everything belongs to process 0
+    cell_owner.assign(domain->cells.n_cells(), 0);
+}
+
+SPH_mpi_domain::~SPH_mpi_domain()
+{
+    // the domain may outlive MPI_Finalize in the driver
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (!finalized)
+        MPI_Type_free(&MPI_Particle);
+}
+
+void SPH_mpi_domain::buildMPIType()
+{
+    int block_lengths[7];
+    MPI_Aint offsets[7];
+    MPI_Aint addresses[7], add_start;
+    MPI_Datatype typelist[7];
+
+    SPH_particle temp;
+
+    typelist[0] = MPI_DOUBLE;
+    block_lengths[0] = 2;
+    MPI_Get_address(temp.x, &addresses[0]);
+
+    typelist[1] = MPI_DOUBLE;
+    block_lengths[1] = 2;
+    MPI_Get_address(temp.v, &addresses[1]);
+
+    typelist[2] = MPI_DOUBLE;
+    block_lengths[2] = 1;
+    MPI_Get_address(&temp.rho, &addresses[2]);
+
+    typelist[3] = MPI_DOUBLE;
+    block_lengths[3] = 1;
+    MPI_Get_address(&temp.P, &addresses[3]);
+
+    typelist[4] = MPI_CXX_BOOL;
+    block_lengths[4] = 1;
+    MPI_Get_address(&temp.boundary_status, &addresses[4]);
+
+    typelist[5] = MPI_INT;
+    block_lengths[5] = 1;
+    MPI_Get_address(&temp.id, &addresses[5]);
+
+    // the level of a ghost wakes up the particles around it
+    typelist[6] = MPI_INT;
+    block_lengths[6] = 1;
+    MPI_Get_address(&temp.level, &addresses[6]);
+
+    MPI_Get_address(&temp, &add_start);
+    for (int i = 0; i < 7; i++) offsets[i] = addresses[i] - add_start;
+
+    // stretch the type to a whole particle so that particle arrays can be sent directly
+    MPI_Datatype struct_type;
+    MPI_Type_create_struct(7, block_lengths, offsets, typelist, &struct_type);
+    MPI_Type_create_resized(struct_type, 0, sizeof(SPH_particle), &MPI_Particle);
+    MPI_Type_commit(&MPI_Particle);
+    MPI_Type_free(&struct_type);
+}
+
+double SPH_mpi_domain::global_min(double value)
+{
+    double result;
+    MPI_Allreduce(&value, &result, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+    return result;
+}
+
+void SPH_mpi_domain::global_sum(double* values, int n)
+{
+    MPI_Allreduce(MPI_IN_PLACE, values, n, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+}
+
+void SPH_mpi_domain::global_max(double* values, int n)
+{
+    MPI_Allreduce(MPI_IN_PLACE, values, n, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+}
+
+long SPH_mpi_domain::global_size()
+{
+    long local = 0, total;
+    for (const SPH_particle& part : domain->particle_list)
+        if (!part.ghost)
+            local++;
+    MPI_Allreduce(&local, &total, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+    return total;
+}
+
+void SPH_mpi_domain::partition(bool bisection)
+{
+    const SPH_cell_list& cells = domain->cells;
+
+    // global number of particles in every cell
+    vector<long> local(cells.n_cells(), 0), count(cells.n_cells());
+    for (const SPH_particle& part : domain->particle_list)
+        if (!part.ghost)
+            local[cells.cell_id(part.list_num[0], part.list_num[1])]++;
+    MPI_Allreduce(local.data(), count.data(), cells.n_cells(), MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+    bisect(0, cells.max_list[0], 0, cells.max_list[1], 0, p, count, !bisection);
+}
+
+void SPH_mpi_domain::bisect(int ci0, int ci1, int cj0, int cj1, int r0, int r1, const vector<long>& count, bool along_x_only)
+{
+    const SPH_cell_list& cells = domain->cells;
+
+    bool split_x = along_x_only || ci1 - ci0 >= cj1 - cj0;
+    int lo = split_x ? ci0 : cj0, hi = split_x ? ci1 : cj1;
+
+    // one process left, or nothing left to split
+    if (r1 - r0 == 1 || hi - lo < 2)
+    {
+        for (int ci = ci0; ci < ci1; ci++)
+            for (int cj = cj0; cj < cj1; cj++)
+                cell_owner[cells.cell_id(ci, cj)] = r0;
+        return;
+    }
+
+    // particles in every line of cells across the split direction
+    vector<long> line(hi - lo, 0);
+    long total = 0;
+    for (int ci = ci0; ci < ci1; ci++)
+        for (int cj = cj0; cj < cj1; cj++)
+        {
+            long c = count[cells.cell_id(ci, cj)];
+            line[(split_x ? ci : cj) - lo] += c;
+            total += c;
+        }
+
+    // the first half of the processes gets its share of the particles
+    int r_mid = r0 + (r1 - r0) / 2;
+    double target = total * double(r_mid - r0) / (r1 - r0);
+
+    int s = lo + 1;
+    long sum = line[0];
+    while (s < hi - 1 && sum + line[s - lo] / 2 < target)
+    {
+        sum += line[s - lo];
+        s++;
+    }
+
+    if (split_x)
+    {
+        bisect(ci0, s, cj0, cj1, r0, r_mid, count, along_x_only);
+        bisect(s, ci1, cj0, cj1, r_mid, r1, count, along_x_only);
+    }
+    else
+    {
+        bisect(ci0, ci1, cj0, s, r0, r_mid, count, along_x_only);
+        bisect(ci0, ci1, s, cj1, r_mid, r1, count, along_x_only);
+    }
+}
+
+void SPH_mpi_domain::exchange(vector<vector<SPH_particle>>& send, vector<SPH_particle>& received)
+{
+    vector<int> send_count(p), recv_count(p), send_displ(p, 0), recv_displ(p, 0);
+    for (int r = 0; r < p; r++)
+        send_count[r] = int(send[r].size());
+
+    MPI_Alltoall(send_count.data(), 1, MPI_INT, recv_count.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+    for (int r = 1; r < p; r++)
+    {
+        send_displ[r] = send_displ[r - 1] + send_count[r - 1];
+        recv_displ[r] = recv_displ[r - 1] + recv_count[r - 1];
+    }
+
+    vector<SPH_particle> send_buffer;
+    send_buffer.reserve(send_displ[p - 1] + send_count[p - 1]);
+    for (int r = 0; r < p; r++)
+        send_buffer.insert(send_buffer.end(), send[r].begin(), send[r].end());
+
+    received.resize(recv_displ[p - 1] + recv_count[p - 1]);
+
+    MPI_Alltoallv(send_buffer.data(), send_count.data(), send_displ.data(), MPI_Particle,
+        received.data(), recv_count.data(), recv_displ.data(), MPI_Particle, MPI_COMM_WORLD);
+
+    // only the exchanged fields arrive, the grid index is computed here
+    for (SPH_particle& part : received)
+        part.calc_index(domain->min_x, domain->h);
+}
+
+void SPH_mpi_domain::migrate()
+{
+    const SPH_cell_list& cells = domain->cells;
+    vector<SPH_particle>& particle_list = domain->particle_list;
+
+    vector<vector<SPH_particle>> send(p);
+    vector<SPH_particle> received;
+
+    // keep the local particles at the front of the list
+    size_t kept = 0;
+    for (size_t i = 0; i < particle_list.size(); i++)
+    {
+        int owner = cell_owner[cells.cell_id(particle_list[i].list_num[0], particle_list[i].list_num[1])];
+        if (owner == id)
+            particle_list[kept++] = particle_list[i];
+        else
+            send[owner].push_back(particle_list[i]);
+    }
+    particle_list.resize(kept);
+
+    exchange(send, received);
+
+    // the forces are not sent, so a particle that changed process computes them in its next step
+    for (SPH_particle& part : received)
+        part.level = domain->step_levels;
+    particle_list.insert(particle_list.end(), received.begin(), received.end());
+    domain->boundary.binned = false;
+}
+
+void SPH_mpi_domain::exchange_halo()
+{
+    const SPH_cell_list& cells = domain->cells;
+    vector<SPH_particle>& particle_list = domain->particle_list;
+
+    vector<vector<SPH_particle>> send(p);
+    vector<SPH_particle> received;
+
+    for (const SPH_particle& part : particle_list)
+    {
+        // processes owning one of the 8 cells around the particle, each sent one copy
+        int targets[8], n_targets = 0;
+
+        for (int ci = part.list_num[0] - 1; ci <= part.list_num[0] + 1; ci++)
+            for (int cj = part.list_num[1] - 1; cj <= part.list_num[1] + 1; cj++)
+            {
+                if (ci < 0 || ci >= cells.max_list[0] || cj < 0 || cj >= cells.max_list[1])
+                    continue;
+
+                int owner = cell_owner[cells.cell_id(ci, cj)];
+                if (owner != id && find(targets, targets + n_targets, owner) == targets + n_targets)
+                    targets[n_targets++] = owner;
+            }
+
+        for (int t = 0; t < n_targets; t++)
+            send[targets[t]].push_back(part);
+    }
+
+    exchange(send, received);
+
+    for (SPH_particle& part : received)
+        part.ghost = true;
+    particle_list.insert(particle_list.end(), received.begin(), received.end());
+
+    // ghost boundary particles join the boundary set of this step
+    domain->boundary.binned = false;
+}
+
+void SPH_mpi_domain::remove_ghosts()
+{
+    vector<SPH_particle>& particle_list = domain->particle_list;
+    particle_list.erase(remove_if(particle_list.begin(), particle_list.end(),
+        [](const SPH_particle& part) { return part.ghost; }), particle_list.end());
+    domain->boundary.binned = false;
+}
+
+void SPH_mpi_domain::step(bool smooth, bool predictor_corrector, bool stencil)
+{
+    migrate();
+    exchange_halo();
+
+    // the particle list has changed, so the grid has to be rebuilt before smoothing
+    domain->allocate_to_grid();
+
+    if (predictor_corrector)
+        domain->predictor_corrector(smooth, false, stencil);
+    else
+        domain->forward_euler(smooth, stencil);
+
+    remove_ghosts();
+}
+
+#endif
@@ -0,0 +1,509 @@
+#include "../includes/SPH_nd.h"
+
+template <int Dim>
+void SPH_solver<Dim>::set_values(double h_factor, double DX, double T_MAX, const double* lower, const double* upper)
+{
+    for (int k = 0; k < Dim; k++)
+    {
+        inner_min_x[k] = min_x[k] = lower[k];
+        inner_max_x[k] = max_x[k] = upper[k];
+    }
+
+    dx = DX;
+    h_fac = h_factor;
+    h = dx * h_fac;
+    t_max = T_MAX;
+    delta_t = 0.1 * h / C0;
+}
+
+template <int Dim>
+void SPH_solver<Dim>::initialise_grid()
+{
+    for (int k = 0; k < Dim; k++)
+    {
+        // enlarge the region to set boundary particles
+        min_x[k] -= 3.0 * h;
+        max_x[k] += 3.0 * h;
+
+        max_list[k] = int((max_x[k] - min_x[k]) / (2.0 * h) + 1.0);
+    }
+}
+
+template <int Dim>
+int SPH_solver<Dim>::n_cells() const
+{
+    int n = 1;
+    for (int k = 0; k < Dim; k++)
+        n *= max_list[k];
+    return n;
+}
+
+template <int Dim>
+void SPH_solver<Dim>::cell_of(const double* position, int* c) const
+{
+    for (int k = 0; k < Dim; k++)
+        c[k] = int((position[k] - min_x[k]) / (2.0 * h));
+}
+
+template <int Dim>
+int SPH_solver<Dim>::linear_cell(int i) const
+{
+    int c = 0;
+    for (int k = 0; k < Dim; k++)
+        c = c * max_list[k] + int((x[k][i] - min_x[k]) / (2.0 * h));
+    return c;
+}
+
+template <int Dim>
+int SPH_solver<Dim>::add_particle(const double* position, bool boundary)
+{
+    if (boundary && n_boundary != int(size()))
+    {
+        cerr << "boundary particles have to be added before the fluid particles" << endl;
+        return 1;
+    }
+
+    int c[Dim];
+    cell_of(position, c);
+    for (int k = 0; k < Dim; k++)
+        if (position[k] < min_x[k] || c[k] >= max_list[k])
+        {
+            cerr << "particle outside the grid" << endl;
+            return 1;
+        }
+
+    for (int k = 0; k < Dim; k++)
+    {
+        x[k].push_back(position[k]);
+        v[k].push_back(0);
+        a[k].push_back(0);
+    }
+    rho.push_back(rho0);
+    P.push_back(0);
+    D.push_back(0);
+    id.push_back(int(id.size()));
+
+    if (boundary)
+    {
+        n_boundary++;
+        boundary_binned = false;
+    }
+    return 0;
+}
+
+template <int Dim>
+long SPH_solver<Dim>::place_points(const double* fluid_lower, const double* fluid_upper)
+{
+    // points of the lattice along every axis, accumulated from min_x like place_points
+    int n[Dim];
+    long total = 1;
+    for (int k = 0; k < Dim; k++)
+    {
+        n[k] = int((max_x[k] - min_x[k]) / dx) + 1;
+        total *= n[k];
+    }
+
+    long placed = 0;
+
+    // the walls in the first pass, so that they come first, the fluid block in the second
+    for (int pass = 0; pass < 2; pass++)
+        for (long p = 0; p < total; p++)
+        {
+            double position[Dim];
+            bool wall = false, fluid = true;
+
+            // the last axis runs fastest
+            long rest = p;
+            for (int k = Dim - 1; k >= 0; k--)
+            {
+                position[k] = min_x[k] + (rest % n[k]) * dx;
+                rest /= n[k];
+
+                wall = wall || position[k] < inner_min_x[k] || position[k] > inner_max_x[k];
+                fluid = fluid && position[k] > fluid_lower[k] && position[k] < fluid_upper[k];
+            }
+
+            if ((pass == 0 && wall) || (pass == 1 && !wall && fluid))
+                placed += add_particle(position, pass == 0) == 0;
+        }
+
+    return placed;
+}
+
+template <int Dim>
+void SPH_solver<Dim>::sort_range(int first, int last, vector<int>& start)
+{
+    int cells = n_cells();
+    int n = last - first;
+
+    cell.resize(size());
+    order.resize(n);
+
+#pragma omp parallel for num_threads(num_threads)
+    for (int i = first; i < last; i++)
+        cell[i] = linear_cell(i);
+
+    // counting sort, start[c] is the first particle of cell c
+    start.assign(cells + 1, 0);
+    for (int i = first; i < last; i++)
+        start[cell[i] + 1]++;
+    start[0] = first;
+    for (int c = 0; c < cells; c++)
+        start[c + 1] += start[c];
+
+    // destination of every particle, stable within a cell
+    cursor.assign(start.begin(), start.end() - 1);
+    for (int i = first; i < last; i++)
+        order[i - first] = cursor[cell[i]]++;
+
+    sorted.resize(n);
+    auto permute = [&](vector<double>& field)
+    {
+#pragma omp parallel for num_threads(num_threads)
+        for (int i = first; i < last; i++)
+            sorted[order[i - first] - first] = field[i];
+        copy(sorted.begin(), sorted.end(), field.begin() + first);
+    };
+
+    for (int k = 0; k < Dim; k++)
+    {
+        permute(x[k]);
+        permute(v[k]);
+    }
+    permute(rho);
+    permute(P);
+
+    sorted_id.resize(n);
+    for (int i = first; i < last; i++)
+        sorted_id[order[i - first] - first] = id[i];
+    copy(sorted_id.begin(), sorted_id.end(), id.begin() + first);
+}
+
+template <int Dim>
+void SPH_solver<Dim>::allocate_to_grid()
+{
+    // boundary particles never move, so their cells only change when particles are added
+    if (!boundary_binned)
+    {
+        sort_range(0, n_boundary, boundary_start);
+        boundary_binned = true;
+    }
+
+    sort_range(n_boundary, int(size()), fluid_start);
+}
+
+template <int Dim>
+template <class Kernel, bool smooth, bool fluid>
+void SPH_solver<Dim>::neighbour_iterate(int i, double& cfl, long& found, long& examined)
+{
+    const double four_h2 = 4.0 * h * h;
+    const double inv_h = 1.0 / h;
+
+    double norm = kernel_norm<Kernel, Dim>() * inv_h;
+    double m = rho0;
+    for (int k = 0; k < Dim; k++)
+    {
+        norm *= inv_h;
+        m *= dx;
+    }
+
+    // fields of the target particle
+    double xi[Dim], vi[Dim], ai[Dim];
+    for (int k = 0; k < Dim; k++)
+    {
+        xi[k] = x[k][i];
+        vi[k] = v[k][i];
+        ai[k] = 0;
+    }
+    if constexpr (fluid)
+        ai[Dim - 1] = G;
+
+    const double inv_rho2_i = 1.0 / (rho[i] * rho[i]);
+    const double P_rho2_i = P[i] * inv_rho2_i;
+
+    // the particle itself is part of its Shepard sums
+    double Di = 0, sum = Kernel::w(0), sum_rho = Kernel::w(0) / rho[i];
+
+    auto visit = [&](int first, int last, auto forces)
+    {
+        constexpr bool pair_forces = decltype(forces)::value;
+        examined += last - first;
+
+        for (int j = first; j < last; j++)
+        {
+            double dn[Dim], dv[Dim], r2 = 0;
+            for (int k = 0; k < Dim; k++)
+            {
+                dn[k] = xi[k] - x[k][j];
+                r2 += dn[k] * dn[k];
+            }
+
+            // only particle within 2h, excluding the particle itself
+            if (r2 >= four_h2 || r2 == 0)
+                continue;
+
+            double dist = sqrt(r2);
+            double w, dw;
+            if constexpr (smooth)
+                Kernel::w_dw(dist * inv_h, w, dw);
+            else
+                dw = Kernel::dw(dist * inv_h);
+
+            if constexpr (smooth)
+            {
+                sum += w;
+                sum_rho += w / rho[j];
+            }
+
+            if constexpr (pair_forces)
+            {
+                found++;
+
+                double f = m * norm * dw / dist;
+                double inv_rho2_j = 1.0 / (rho[j] * rho[j]);
+                double viscous = mu * (inv_rho2_i + inv_rho2_j), pressure = P_rho2_i + P[j] * inv_rho2_j;
+
+                double dot = 0, v2 = 0;
+                for (int k = 0; k < Dim; k++)
+                {
+                    dv[k] = vi[k] - v[k][j];
+                    dot += dv[k] * dn[k];
+                    v2 += dv[k] * dv[k];
+                    if constexpr (fluid)
+                        ai[k] += f * (viscous * dv[k] - pressure * dn[k]);
+                }
+                Di += f * dot;
+
+                // dt_cfl of the pair
+                cfl = min(cfl, SPH_time_step::cfl_limit(h, v2));
+            }
+        }
+    };
+
+    int c[Dim], lo[Dim], hi[Dim];
+    cell_of(xi, c);
+    for (int k = 0; k < Dim; k++)
+    {
+        lo[k] = max(c[k] - 1, 0);
+        hi[k] = min(c[k] + 1, max_list[k] - 1);
+    }
+
+    // every combination of the first Dim - 1 axes, the cells along the last axis are one range
+    int n_rows = 1;
+    for (int k = 0; k < Dim - 1; k++)
+        n_rows *= hi[k] - lo[k] + 1;
+
+    for (int row = 0; row < n_rows; row++)
+    {
+        int base = 0, rest = row;
+        for (int k = Dim - 2; k >= 0; k--)
+        {
+            int extent = hi[k] - lo[k] + 1;
+            int ck = lo[k] + rest % extent;
+            rest /= extent;
+
+            int stride = 1;
+            for (int l = k + 1; l < Dim; l++)
+                stride *= max_list[l];
+            base += ck * stride;
+        }
+
+        int c_lo = base + lo[Dim - 1], c_hi = base + hi[Dim - 1] + 1;
+        visit(fluid_start[c_lo], fluid_start[c_hi], true_type());
+
+        // two boundary particles change neither acceleration nor density of each other, only the Shepard sums
+        if constexpr (fluid)
+            visit(boundary_start[c_lo], boundary_start[c_hi], true_type());
+        else if constexpr (smooth)
+            visit(boundary_start[c_lo], boundary_start[c_hi], false_type());
+    }
+
+    for (int k = 0; k < Dim; k++)
+        a[k][i] = ai[k];
+    D[i] = Di;
+    if constexpr (smooth)
+    {
+        w_sum[i] = sum;
+        w_rho[i] = sum_rho;
+    }
+}
+
+template <int Dim>
+void SPH_solver<Dim>::compute_forces(bool change_delta_t, bool smooth)
+{
+    if (smooth)
+    {
+        w_sum.resize(size());
+        w_rho.resize(size());
+    }
+
+    double cfl = SPH_DT_NONE, force = SPH_DT_NONE, acoustic = SPH_DT_NONE;
+    long found = 0, examined = 0;
+
+    // every particle only writes its own accumulators, so the particles are independent
+    visit_kernel(kernel, tabulate_kernel, [&](auto policy)
+    {
+        using Kernel = decltype(policy);
+
+        auto sweep = [&](auto fused)
+        {
+            constexpr bool fuse = decltype(fused)::value;
+#pragma omp parallel for schedule(dynamic, 256) reduction(min:cfl, force, acoustic) reduction(+:found, examined) num_threads(num_threads)
+            for (int i = 0; i < int(size()); i++)
+            {
+                // the boundary particles come first
+                if (i < n_boundary)
+                    neighbour_iterate<Kernel, fuse, false>(i, cfl, found, examined);
+                else
+                    neighbour_iterate<Kernel, fuse, true>(i, cfl, found, examined);
+
+                if (change_delta_t)
+                {
+                    double a2 = 0;
+                    for (int k = 0; k < Dim; k++)
+                        a2 += a[k][i] * a[k][i];
+                    if (i >= n_boundary)
+                        force = min(force, SPH_time_step::force_limit(h, a2));
+                    acoustic = min(acoustic, SPH_time_step::acoustic_limit(h, C0, rho[i] / rho0));
+                }
+            }
+        };
+
+        if (smooth)
+            sweep(true_type());
+        else
+            sweep(false_type());
+    });
+
+    candidates = examined;
+    pairs = found;
+
+    // the forces of this sweep were computed with the densities before smoothing
+    if (smooth)
+    {
+#pragma omp parallel for num_threads(num_threads)
+        for (int i = 0; i < int(size()); i++)
+            rho[i] = w_sum[i] / w_rho[i];
+    }
+
+    if (change_delta_t)
+        delta_t = time_step.next(delta_t, cfl, force, acoustic);
+}
+
+template <int Dim>
+void SPH_solver<Dim>::forward_euler(bool smooth)
+{
+    allocate_to_grid();
+    compute_forces(time_step.adaptive, smooth);
+
+    // boundary particles keep their place and zero velocity, only the density and pressure change
+#pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < n_boundary; i++)
+    {
+        rho[i] = rho[i] + delta_t * D[i];
+        update_P(i);
+    }
+
+#pragma omp parallel for num_threads(num_threads)
+    for (int i = n_boundary; i < int(size()); i++)
+    {
+        for (int k = 0; k < Dim; k++)
+        {
+            x[k][i] = x[k][i] + delta_t * v[k][i];
+            if (x[k][i] < inner_min_x[k] || x[k][i] > inner_max_x[k])
+            {
+                // bounce the particle back off the wall
+                x[k][i] = x[k][i] - delta_t * v[k][i];
+                v[k][i] = -velocity_lost_rate * v[k][i];
+            }
+            else
+                v[k][i] = v[k][i] + delta_t * a[k][i];
+        }
+        rho[i] = rho[i] + delta_t * D[i];
+        update_P(i);
+    }
+}
+
+template <int Dim>
+void SPH_solver<Dim>::predictor_corrector(bool smooth)
+{
+    allocate_to_grid();
+    compute_forces(time_step.adaptive, smooth);
+
+    // the previous state is only needed by this scheme
+    for (int k = 0; k < Dim; k++)
+    {
+        prev_x[k].resize(size());
+        prev_v[k].resize(size());
+    }
+    prev_rho.resize(size());
+
+    // half step
+#pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < int(size()); i++)
+    {
+        prev_rho[i] = rho[i];
+
+        if (i >= n_boundary)
+            for (int k = 0; k < Dim; k++)
+            {
+                prev_x[k][i] = x[k][i];
+                prev_v[k][i] = v[k][i];
+
+                x[k][i] = x[k][i] + 0.5 * delta_t * v[k][i];
+                if (x[k][i] < inner_min_x[k] || x[k][i] > inner_max_x[k])
+                {
+                    x[k][i] = x[k][i] - 0.5 * delta_t * v[k][i];
+                    v[k][i] = -velocity_lost_rate * prev_v[k][i];
+                }
+                else
+                    v[k][i] = v[k][i] + 0.5 * delta_t * a[k][i];
+            }
+
+        rho[i] = rho[i] + 0.5 * delta_t * D[i];
+        update_P(i);
+    }
+
+    // full step from the previous state with the half step velocities
+#pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < int(size()); i++)
+    {
+        if (i >= n_boundary)
+            for (int k = 0; k < Dim; k++)
+            {
+                double half_x = prev_x[k][i] + 0.5 * delta_t * v[k][i];
+                x[k][i] = 2 * half_x - prev_x[k][i];
+                if (x[k][i] < inner_min_x[k] || x[k][i] > inner_max_x[k])
+                {
+                    x[k][i] = prev_x[k][i];
+                    v[k][i] = -velocity_lost_rate * prev_v[k][i];
+                }
+                else
+                {
+                    double half_v = prev_v[k][i] + 0.5 * delta_t * a[k][i];
+                    v[k][i] = 2 * half_v - prev_v[k][i];
+                }
+            }
+
+        double half_rho = prev_rho[i] + 0.5 * delta_t * D[i];
+        rho[i] = 2 * half_rho - prev_rho[i];
+        update_P(i);
+    }
+}
+
+template <int Dim>
+double SPH_solver<Dim>::kinetic_energy() const
+{
+    double m = rho0;
+    for (int k = 0; k < Dim; k++)
+        m *= dx;
+
+    double energy = 0;
+    for (int i = n_boundary; i < int(size()); i++)
+        for (int k = 0; k < Dim; k++)
+            energy += 0.5 * m * v[k][i] * v[k][i];
+    return energy;
+}
+
+template class SPH_solver<2>;
+template class SPH_solver<3>;
@@ -0,0 +1,157 @@
+#include "../includes/SPH_scheduler.h"
+
+using namespace std;
+
+void SPH_work_stealing::plan(const vector<double>& cost, int n_workers)
+{
+    n_workers = max(n_workers, 1);
+    if (n_workers != n_ranges)
+    {
+        ranges.reset(new task_range[n_workers]);
+        n_ranges = n_workers;
+    }
+    steals = 0;
+
+    double total = 0;
+    for (double c : cost)
+        total += c;
+
+    // worker w starts where the running cost passes w / n_workers of the total
+    uint32_t n = uint32_t(cost.size());
+    uint32_t first = 0;
+    double running = 0;
+    for (int w = 0; w < n_workers; w++)
+    {
+        uint32_t last = first;
+        double target = total * (w + 1) / n_workers;
+        if (w == n_workers - 1)
+            last = n;
+        else
+            while (last < n && running + 0.5 * cost[last] < target)
+                running += cost[last++];
+
+        ranges[w].word.store(pack(first, last), memory_order_relaxed);
+        first = last;
+    }
+}
+
+bool SPH_work_stealing::take(int worker, int& task)
+{
+    atomic<uint64_t>& word = ranges[worker].word;
+    uint64_t current = word.load(memory_order_acquire);
+
+    // a thief may shorten the range from the back at the same time, which makes the swap fail and try again
+    while (front(current) < back(current))
+        if (word.compare_exchange_weak(current, pack(front(current) + 1, back(current)), memory_order_acq_rel))
+        {
+            task = int(front(current));
+            return true;
+        }
+
+    return false;
+}
+
+bool SPH_work_stealing::steal(int worker)
+{
+    for (;;)
+    {
+        // the victim with the most tasks left
+        int victim = -1;
+        uint64_t largest = 0;
+        uint32_t most = 0;
+        for (int w = 0; w < n_ranges; w++)
+        {
+            uint64_t current = ranges[w].word.load(memory_order_acquire);
+            uint32_t left = front(current) < back(current) ? back(current) - front(current) : 0;
+            if (w != worker && left > most)
+            {
+                victim = w;
+                largest = current;
+                most = left;
+            }
+        }
+
+        if (victim < 0)
+            return false;
+
+        // the back half, or the last task, which the victim would take last
+        uint32_t split = back(largest) - (most + 1) / 2;
+        if (ranges[victim].word.compare_exchange_strong(largest, pack(front(largest), split), memory_order_acq_rel))
+        {
+            // the own range is empty, and thieves only ever shorten a range that is not
+            ranges[worker].word.store(pack(split, back(largest)), memory_order_release);
+            steals++;
+            return true;
+        }
+    }
+}
+
+void SPH_task_graph::clear(int n)
+{
+    n_tasks = n;
+    edge_task.clear();
+    edge_before.clear();
+}
+
+void SPH_task_graph::depend(int task, int before)
+{
+    edge_task.push_back(task);
+    edge_before.push_back(before);
+}
+
+void SPH_task_graph::prepare()
+{
+    pending.reset(new atomic<int>[n_tasks]);
+    queue.reset(new atomic<int>[n_tasks]);
+    for (int t = 0; t < n_tasks; t++)
+    {
+        pending[t].store(0, memory_order_relaxed);
+        queue[t].store(-1, memory_order_relaxed);
+    }
+
+    // successors of every task by counting sort of the dependencies
+    successor_start.assign(n_tasks + 1, 0);
+    for (size_t e = 0; e < edge_task.size(); e++)
+    {
+        successor_start[edge_before[e] + 1]++;
+        pending[edge_task[e]].fetch_add(1, memory_order_relaxed);
+    }
+    for (int t = 0; t < n_tasks; t++)
+        successor_start[t + 1] += successor_start[t];
+
+    successors.resize(edge_task.size());
+    vector<int> cursor(successor_start.begin(), successor_start.end() - 1);
+    for (size_t e = 0; e < edge_task.size(); e++)
+        successors[cursor[edge_before[e]]++] = edge_task[e];
+
+    head.store(0, memory_order_relaxed);
+    tail.store(0, memory_order_relaxed);
+    for (int t = 0; t < n_tasks; t++)
+        if (pending[t].load(memory_order_relaxed) == 0)
+            queue[tail.fetch_add(1, memory_order_relaxed)].store(t, memory_order_relaxed);
+}
+
+bool SPH_task_graph::next(int& task)
+{
+    for (;;)
+    {
+        int slot = head.load(memory_order_acquire);
+        if (slot >= n_tasks)
+            return false;
+
+        // the slot is empty while every ready task is running, or while its task is being queued
+        task = queue[slot].load(memory_order_acquire);
+        if (task < 0)
+            this_thread::yield();
+        else if (head.compare_exchange_weak(slot, slot + 1, memory_order_acq_rel))
+            return true;
+    }
+}
+
+void SPH_task_graph::finish(int task)
+{
+    // the last dependency to finish queues the task, and its writes are seen through the queue slot
+    for (int k = successor_start[task]; k < successor_start[task + 1]; k++)
+        if (pending[successors[k]].fetch_sub(1, memory_order_acq_rel) == 1)
+            queue[tail.fetch_add(1, memory_order_acq_rel)].store(successors[k], memory_order_release);
+}
@@ -0,0 +1,100 @@
+#include <omp.h>
+#include "../includes/SPH_soa.h"
+#include "../includes/SPH_2D.h"
+
+void SPH_soa::resize(size_t n_particles)
+{
+    n = n_particles;
+
+    size_t padded = n + SPH_BATCH;
+    x.resize(padded);
+    y.resize(padded);
+    vx.resize(padded);
+    vy.resize(padded);
+    rho.resize(padded);
+    P.resize(padded);
+    P_rho2.resize(padded);
+    inv_rho2.resize(padded);
+    ax.resize(padded);
+    ay.resize(padded);
+    D.resize(padded);
+    w_sum.resize(padded);
+    w_rho.resize(padded);
+
+    // padding particles are far outside any kernel support
+    for (size_t i = n; i < padded; i++)
+    {
+        x[i] = y[i] = 1e30;
+        vx[i] = vy[i] = 0;
+        rho[i] = rho0;
+        P[i] = P_rho2[i] = 0;
+        inv_rho2[i] = 1.0 / (rho0 * rho0);
+        ax[i] = ay[i] = D[i] = 0;
+        w_sum[i] = w_rho[i] = 0;
+    }
+}
+
+void SPH_soa::gather(const vector<SPH_particle>& particle_list, double gravity, int num_threads)
+{
+    resize(particle_list.size());
+
+    // the copy is memory bound, so every thread takes one contiguous range
+    int n_particles = int(particle_list.size());
+#pragma omp parallel num_threads(num_threads)
+    {
+        int t = omp_get_thread_num(), n_threads = omp_get_num_threads();
+        gather(particle_list, gravity, int(long(n_particles) * t / n_threads), int(long(n_particles) * (t + 1) / n_threads));
+    }
+}
+
+void SPH_soa::gather(const vector<SPH_particle>& particle_list, double gravity, int first, int last)
+{
+    for (int i = first; i < last; i++)
+    {
+        const SPH_particle& p = particle_list[i];
+        x[i] = p.x[0];
+        y[i] = p.x[1];
+        vx[i] = p.v[0];
+        vy[i] = p.v[1];
+        rho[i] = p.rho;
+        P[i] = p.P;
+        inv_rho2[i] = 1.0 / (p.rho * p.rho);
+        P_rho2[i] = p.P * inv_rho2[i];
+
+        // reset acceleration and density change, boundary particles are handled in scatter
+        ax[i] = 0;
+        ay[i] = gravity;
+        D[i] = 0;
+    }
+}
+
+void SPH_soa::scatter(vector<SPH_particle>& particle_list, int num_threads) const
+{
+    int n_particles = int(particle_list.size());
+#pragma omp parallel num_threads(num_threads)
+    {
+        int t = omp_get_thread_num(), n_threads = omp_get_num_threads();
+        scatter(particle_list, int(long(n_particles) * t / n_threads), int(long(n_particles) * (t + 1) / n_threads));
+    }
+}
+
+void SPH_soa::scatter(vector<SPH_particle>& particle_list, int first, int last) const
+{
+    for (int i = first; i < last; i++)
+    {
+        SPH_particle& p = particle_list[i];
+
+        // boundary particles never accelerate
+        if (p.boundary_status)
+        {
+            p.a[0] = 0;
+            p.a[1] = 0;
+        }
+        else
+        {
+            p.a[0] = ax[i];
+            p.a[1] = ay[i];
+        }
+        p.D = D[i];
+    }
+}
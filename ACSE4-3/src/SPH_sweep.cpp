@@ -0,0 +1,163 @@
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include "../includes/SPH_sweep.h"
+#include "../includes/SPH_2D.h"
+#include "../includes/SPH_analytics.h"
+#include "../includes/snapshot_writer.h"
+
+int read_sweep(const char* filename, vector<SPH_run_config>& configs)
+{
+    ifstream fs(filename);
+    if (!fs)
+    {
+        cerr << "could not open sweep file " << filename << endl;
+        return 1;
+    }
+
+    string line;
+    int line_number = 0;
+    while (getline(fs, line))
+    {
+        line_number++;
+        istringstream is(line);
+        SPH_run_config config;
+        string scheme;
+        if (!(is >> config.name) || config.name[0] == '#')
+            continue;
+
+        if (!(is >> config.dx >> config.h_factor >> config.t_max >> scheme) || (scheme != "fe" && scheme != "pc")
+            || config.dx <= 0 || config.h_factor <= 0)
+        {
+            cerr << filename << ":" << line_number << ": expected \"name dx h_factor t_max fe|pc [geometry]\"" << endl;
+            return 1;
+        }
+        config.predictor_corrector = scheme == "pc";
+        is >> config.geometry;
+        configs.push_back(config);
+    }
+    return 0;
+}
+
+SPH_run_summary run_simulation(const SPH_run_config& config)
+{
+    SPH_run_summary summary;
+    summary.name = config.name;
+    string prefix = config.prefix.empty() ? config.name + "_" : config.prefix;
+
+    SPH_main domain;
+    domain.num_threads = config.num_threads;
+    domain.time_step.adaptive = config.predictor_corrector;
+    domain.set_values(config.h_factor, config.dx, config.t_max);
+
+    if (config.geometry.empty())
+    {
+        domain.initialise_grid();
+        domain.place_points(domain.min_x, domain.max_x);
+    }
+    else
+    {
+        SPH_geometry geometry;
+        if (geometry.read(config.geometry.c_str()))
+        {
+            summary.status = 1;
+            return summary;
+        }
+        geometry.apply_domain(domain);
+        domain.initialise_grid();
+        domain.place_points(geometry, domain.min_x, domain.max_x);
+    }
+
+    // the final state is kept for the summary even when no file is written
+    SPH_analytics analytics;
+    analytics.enabled = true;
+    analytics.interval = 1;
+    if (config.analytics && analytics.open(prefix + "analytics.csv"))
+        summary.status = 1;
+
+    SPH_snapshot_writer writer(2);
+
+    auto start = chrono::steady_clock::now();
+    double time = 0;
+    int cnt = 0;
+    while (time < domain.t_max)
+    {
+        domain.allocate_to_grid();
+        bool smooth = config.smooth_interval > 0 && cnt % config.smooth_interval == 0;
+
+        if (config.predictor_corrector)
+            domain.predictor_corrector(smooth);
+        else
+            domain.forward_euler(smooth);
+
+        if (config.snapshot_interval > 0 && cnt % config.snapshot_interval == 0)
+            writer.submit(prefix + to_string(cnt / config.snapshot_interval) + ".vtp", domain.particle_list);
+
+        cnt++;
+        time += domain.delta_t;
+        analytics.record(domain, time, cnt);
+    }
+    writer.finish();
+    analytics.close();
+
+    summary.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    summary.particles = int(domain.particle_list.size());
+    summary.steps = cnt;
+    summary.time = time;
+    if (cnt > 0 && summary.particles > 0)
+        summary.ns_per_particle_step = summary.seconds * 1e9 / cnt / summary.particles;
+    summary.kinetic_energy = analytics.kinetic_energy;
+    summary.max_velocity = analytics.max_velocity;
+    summary.surge_front = analytics.surge_front;
+
+    ofstream fs(prefix + "summary.json");
+    if (!fs)
+    {
+        cerr << "could not write " << prefix << "summary.json" << endl;
+        summary.status = 1;
+        return summary;
+    }
+    fs << setprecision(10);
+    fs << "{\n";
+    fs << "  \"name\": \"" << config.name << "\",\n";
+    fs << "  \"dx\": " << config.dx << ",\n";
+    fs << "  \"h_factor\": " << config.h_factor << ",\n";
+    fs << "  \"scheme\": \"" << (config.predictor_corrector ? "pc" : "fe") << "\",\n";
+    fs << "  \"threads\": " << config.num_threads << ",\n";
+    fs << "  \"particles\": " << summary.particles << ",\n";
+    fs << "  \"steps\": " << summary.steps << ",\n";
+    fs << "  \"time\": " << summary.time << ",\n";
+    fs << "  \"seconds\": " << summary.seconds << ",\n";
+    fs << "  \"ns_per_particle_step\": " << summary.ns_per_particle_step << ",\n";
+    fs << "  \"kinetic_energy\": " << summary.kinetic_energy << ",\n";
+    fs << "  \"max_velocity\": " << summary.max_velocity << ",\n";
+    fs << "  \"surge_front\": " << summary.surge_front << "\n";
+    fs << "}\n";
+    return summary;
+}
+
+vector<SPH_run_summary> run_sweep(const vector<SPH_run_config>& configs, int workers)
+{
+    vector<SPH_run_summary> summaries(configs.size());
+    atomic<size_t> next(0);
+
+    // every worker writes only the summaries of the runs it took
+    auto work = [&]()
+    {
+        for (size_t r = next++; r < configs.size(); r = next++)
+            summaries[r] = run_simulation(configs[r]);
+    };
+
+    workers = max(1, min(workers, int(configs.size())));
+    vector<thread> pool;
+    for (int w = 1; w < workers; w++)
+        pool.emplace_back(work);
+    work();
+    for (thread& worker : pool)
+        worker.join();
+
+    return summaries;
+}
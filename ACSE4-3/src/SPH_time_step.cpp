@@ -0,0 +1,23 @@
+#include <algorithm>
+#include "../includes/SPH_time_step.h"
+
+double SPH_time_step::next(double previous, double cfl, double force, double acoustic, int steps)
+{
+    double smallest = std::min(std::min(cfl, force), acoustic);
+    double grown = std::pow(max_growth, steps) * previous;
+
+    double dt = safety * smallest;
+    if (dt < grown)
+        limiter = smallest == cfl ? SPH_DT_CFL : smallest == force ? SPH_DT_FORCE : SPH_DT_ACOUSTIC;
+    else
+    {
+        dt = grown;
+        limiter = SPH_DT_GROWTH;
+    }
+
+    // previous is the same on all processes, so the global minimum is the step every process would take
+    if (reduce_min)
+        dt = reduce_min(dt);
+
+    return dt;
+}
@@ -0,0 +1,74 @@
+#include <iostream>
+#include "../includes/SPH_trace.h"
+
+static const char* limiter_names[] = { "fixed", "cfl", "force", "acoustic", "growth" };
+
+SPH_trace::~SPH_trace()
+{
+    close();
+}
+
+int SPH_trace::open(const std::string& filename)
+{
+#ifdef SPH_NO_TRACE
+    std::cerr << "tracing was compiled out with SPH_NO_TRACE" << std::endl;
+    return 1;
+#endif
+
+    close();
+
+    file.open(filename);
+    if (!file)
+    {
+        std::cerr << "could not open trace file " << filename << std::endl;
+        return 1;
+    }
+
+    json = filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".json") == 0;
+    if (json)
+        file << "[";
+    else
+        file << "step,time,delta_t,limiter,particles,t_grid,t_forces,t_smoothing,t_integration,candidates,pairs,max_per_cell,verlet_builds\n";
+
+    enabled = true;
+    rows = 0;
+    current = SPH_step_record();
+    return 0;
+}
+
+void SPH_trace::close()
+{
+    if (!enabled)
+        return;
+
+    if (json)
+        file << "\n]\n";
+    file.close();
+    enabled = false;
+}
+
+void SPH_trace::end_step(double delta_t, size_t particles)
+{
+    step++;
+    time += delta_t;
+
+    if (!enabled)
+        return;
+
+    const SPH_step_record& r = current;
+    if (json)
+        file << (rows > 0 ? ",\n" : "\n")
+             << "{ \"step\": " << step << ", \"time\": " << time << ", \"delta_t\": " << delta_t
+             << ", \"limiter\": \"" << limiter_names[r.limiter] << "\", \"particles\": " << particles
+             << ", \"t_grid\": " << r.t_grid << ", \"t_forces\": " << r.t_forces
+             << ", \"t_smoothing\": " << r.t_smoothing << ", \"t_integration\": " << r.t_integration
+             << ", \"candidates\": " << r.candidates << ", \"pairs\": " << r.pairs
+             << ", \"max_per_cell\": " << r.max_per_cell << ", \"verlet_builds\": " << r.verlet_builds << " }";
+    else
+        file << step << ',' << time << ',' << delta_t << ',' << limiter_names[r.limiter] << ',' << particles << ','
+             << r.t_grid << ',' << r.t_forces << ',' << r.t_smoothing << ',' << r.t_integration << ','
+             << r.candidates << ',' << r.pairs << ',' << r.max_per_cell << ',' << r.verlet_builds << '\n';
+
+    rows++;
+    current = SPH_step_record();
+}
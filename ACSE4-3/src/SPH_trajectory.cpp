@@ -0,0 +1,466 @@
+#include <cstring>
+#include <filesystem>
+#include "../includes/SPH_trajectory.h"
+
+static const char trajectory_magic[8] = { 'S', 'P', 'H', 'T', 'R', 'A', 'J', '\0' };
+
+// bit stream of 64 bit words, filled from the lowest bit
+class bit_writer
+{
+public:
+    bit_writer(vector<uint64_t>& words) : words(words) { words.clear(); }
+
+    // the lowest n bits of value, n from 1 to 64
+    void put(uint64_t value, int n)
+    {
+        if (n < 64)
+            value &= (uint64_t(1) << n) - 1;
+        acc |= value << used;
+        used += n;
+        if (used >= 64)
+        {
+            words.push_back(acc);
+            used -= 64;
+            acc = used > 0 ? value >> (n - used) : 0;
+        }
+    }
+
+    // the bit length n of the zigzag code as 0 if it is the length of the value before, 10 and one bit if
+    // it is one shorter or longer, otherwise 11 and 7 bits, followed by the code below its top bit
+    void put_signed(int64_t value, int& last)
+    {
+        uint64_t u = (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+        int n = u == 0 ? 0 : 64 - __builtin_clzll(u);
+        if (n == last)
+            put(0, 1);
+        else if (n == last - 1 || n == last + 1)
+            put(1 | uint64_t(n > last) << 2, 3);
+        else
+            put(3 | uint64_t(n) << 2, 9);
+        if (n > 1)
+            put(u, n - 1);
+        last = n;
+    }
+
+    void finish()
+    {
+        if (used > 0)
+            words.push_back(acc);
+        acc = 0;
+        used = 0;
+    }
+
+private:
+    vector<uint64_t>& words;
+    uint64_t acc = 0;
+    int used = 0;
+};
+
+class bit_reader
+{
+public:
+    bit_reader(const vector<uint64_t>& words) : words(words) {}
+
+    uint64_t get(int n)
+    {
+        uint64_t value = 0;
+        int got = 0;
+        while (got < n)
+        {
+            if (pos >= words.size())
+            {
+                overrun = true;
+                return 0;
+            }
+            int take = min(n - got, 64 - used);
+            uint64_t bits = words[pos] >> used;
+            if (take < 64)
+                bits &= (uint64_t(1) << take) - 1;
+            value |= bits << got;
+            got += take;
+            used += take;
+            if (used == 64)
+            {
+                pos++;
+                used = 0;
+            }
+        }
+        return value;
+    }
+
+    int64_t get_signed(int& last)
+    {
+        int n = last;
+        if (get(1) == 1)
+        {
+            if (get(1) == 0)
+                n += get(1) == 1 ? 1 : -1;
+            else
+                n = int(get(7));
+        }
+        if (n < 0 || n > 64)
+        {
+            overrun = true;
+            return 0;
+        }
+        last = n;
+        if (n == 0)
+            return 0;
+        uint64_t u = uint64_t(1) << (n - 1);
+        if (n > 1)
+            u |= get(n - 1);
+        return int64_t(u >> 1) ^ -int64_t(u & 1);
+    }
+
+    // whether more bits were read than the stream holds
+    bool overrun = false;
+
+private:
+    const vector<uint64_t>& words;
+    size_t pos = 0;
+    int used = 0;
+};
+
+void SPH_trajectory_state::resize(size_t n)
+{
+    id.resize(n);
+    boundary.resize(n);
+    for (int d = 0; d < 2; d++)
+        q[d].resize(n);
+    for (int f = 0; f < 4; f++)
+        bits[f].resize(n);
+}
+
+static uint32_t float_bits(double value)
+{
+    float f = float(value);
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+static double bits_float(uint32_t bits)
+{
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// the index at the end of a closed file, or the frames found by walking their headers
+static int read_index(istream& file, const SPH_trajectory_header& header, vector<SPH_trajectory_entry>& index)
+{
+    index.clear();
+    if (header.index_offset != 0)
+    {
+        index.resize(header.n_frames);
+        file.seekg(header.index_offset);
+        file.read(reinterpret_cast<char*>(index.data()), index.size() * sizeof(SPH_trajectory_entry));
+        return !file;
+    }
+
+    // a frame cut short by a crash is dropped
+    file.seekg(0, ios::end);
+    uint64_t size = file.tellg();
+    uint64_t offset = sizeof(SPH_trajectory_header);
+    SPH_trajectory_frame_header frame;
+    while (offset + sizeof(frame) <= size)
+    {
+        file.seekg(offset);
+        file.read(reinterpret_cast<char*>(&frame), sizeof(frame));
+        if (!file || offset + sizeof(frame) + frame.n_bytes > size)
+            break;
+        index.push_back({ offset, frame.time, frame.step, frame.keyframe });
+        offset += sizeof(frame) + frame.n_bytes;
+    }
+    file.clear();
+    return 0;
+}
+
+static int read_header(istream& file, SPH_trajectory_header& header)
+{
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    return !file || memcmp(header.magic, trajectory_magic, sizeof(header.magic)) != 0 || header.version != SPH_TRAJECTORY_VERSION;
+}
+
+SPH_trajectory_writer::~SPH_trajectory_writer()
+{
+    close();
+}
+
+int SPH_trajectory_writer::open(const string& filename, const SPH_main& domain, bool append)
+{
+    close();
+    has_previous = false;
+    index.clear();
+
+    if (append && filesystem::exists(filename))
+    {
+        ifstream in(filename, ios::binary);
+        if (read_header(in, header) || read_index(in, header, index))
+        {
+            cerr << filename << " is no trajectory file" << endl;
+            return 1;
+        }
+        in.close();
+
+        // the index is written again behind the new frames
+        uint64_t end = index.empty() ? sizeof(header) : header.index_offset;
+        if (header.index_offset == 0 && !index.empty())
+        {
+            SPH_trajectory_frame_header frame;
+            in.open(filename, ios::binary);
+            in.seekg(index.back().offset);
+            in.read(reinterpret_cast<char*>(&frame), sizeof(frame));
+            end = index.back().offset + sizeof(frame) + frame.n_bytes;
+        }
+        filesystem::resize_file(filename, end);
+        header.index_offset = 0;
+
+        file.open(filename, ios::in | ios::out | ios::binary);
+        file.seekp(0, ios::end);
+    }
+    else
+    {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, trajectory_magic, sizeof(header.magic));
+        header.version = SPH_TRAJECTORY_VERSION;
+        header.keyframe_interval = keyframe_interval;
+        header.origin[0] = domain.min_x[0];
+        header.origin[1] = domain.min_x[1];
+        header.quantum = 2.0 * domain.h / (1 << SPH_TRAJECTORY_CELL_BITS);
+
+        file.open(filename, ios::in | ios::out | ios::binary | ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    if (!file)
+    {
+        cerr << "could not open trajectory " << filename << endl;
+        file.close();
+        return 1;
+    }
+    return 0;
+}
+
+uint64_t SPH_trajectory_writer::write_frame(const vector<SPH_particle>& particle_list, double time, int step)
+{
+    if (!file.is_open())
+        return 0;
+
+    // slots by id, the particles are reordered by the simulation but keep their id
+    int max_id = -1;
+    size_t n = 0;
+    for (const SPH_particle& part : particle_list)
+        if (!part.ghost)
+        {
+            max_id = max(max_id, part.id);
+            n++;
+        }
+
+    slot.assign(max_id + 1, -1);
+    for (size_t i = 0; i < particle_list.size(); i++)
+        if (!particle_list[i].ghost && particle_list[i].id >= 0)
+            slot[particle_list[i].id] = int(i);
+
+    current.resize(n);
+    size_t k = 0;
+    for (int id = 0; id <= max_id; id++)
+    {
+        if (slot[id] < 0)
+            continue;
+        const SPH_particle& part = particle_list[slot[id]];
+        current.id[k] = id;
+        current.boundary[k] = part.boundary_status;
+        for (int d = 0; d < 2; d++)
+            current.q[d][k] = llround((part.x[d] - header.origin[d]) / header.quantum);
+        current.bits[0][k] = float_bits(part.v[0]);
+        current.bits[1][k] = float_bits(part.v[1]);
+        current.bits[2][k] = float_bits(part.rho);
+        current.bits[3][k] = float_bits(part.P);
+        k++;
+    }
+    if (k != n)
+    {
+        cerr << "trajectory frame of step " << step << " skipped, the particle ids are not unique" << endl;
+        return 0;
+    }
+
+    bool keyframe = !has_previous || previous.id != current.id || since_keyframe >= header.keyframe_interval;
+
+    // every array is one stream, with its own length of the value before
+    bit_writer out(words);
+    int last = 0;
+    if (keyframe)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            out.put_signed(current.id[i] - (i > 0 ? current.id[i - 1] : 0), last);
+            out.put(current.boundary[i], 1);
+        }
+        for (int d = 0; d < 2; d++)
+        {
+            last = 0;
+            for (size_t i = 0; i < n; i++)
+                out.put_signed(current.q[d][i] - (i > 0 ? current.q[d][i - 1] : 0), last);
+        }
+        for (int f = 0; f < 4; f++)
+        {
+            last = 0;
+            for (size_t i = 0; i < n; i++)
+                out.put_signed(int32_t(current.bits[f][i] - (i > 0 ? current.bits[f][i - 1] : 0)), last);
+        }
+    }
+    else
+    {
+        for (int d = 0; d < 2; d++)
+        {
+            last = 0;
+            for (size_t i = 0; i < n; i++)
+                out.put_signed(current.q[d][i] - previous.q[d][i], last);
+        }
+        for (int f = 0; f < 4; f++)
+        {
+            last = 0;
+            for (size_t i = 0; i < n; i++)
+                out.put_signed(int32_t(current.bits[f][i] - previous.bits[f][i]), last);
+        }
+    }
+    out.finish();
+
+    SPH_trajectory_frame_header frame;
+    frame.n_particles = n;
+    frame.n_bytes = words.size() * sizeof(uint64_t);
+    frame.time = time;
+    frame.step = step;
+    frame.keyframe = keyframe;
+
+    index.push_back({ uint64_t(file.tellp()), time, step, keyframe });
+    file.write(reinterpret_cast<const char*>(&frame), sizeof(frame));
+    file.write(reinterpret_cast<const char*>(words.data()), frame.n_bytes);
+
+    swap(previous, current);
+    has_previous = true;
+    since_keyframe = keyframe ? 1 : since_keyframe + 1;
+    return sizeof(frame) + frame.n_bytes;
+}
+
+void SPH_trajectory_writer::close()
+{
+    if (!file.is_open())
+        return;
+
+    header.index_offset = file.tellp();
+    header.n_frames = index.size();
+    file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(SPH_trajectory_entry));
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+}
+
+int SPH_trajectory_reader::open(const string& filename)
+{
+    file.close();
+    file.clear();
+    decoded = -1;
+
+    file.open(filename, ios::binary);
+    if (!file || read_header(file, header) || read_index(file, header, index))
+    {
+        cerr << "could not read trajectory " << filename << endl;
+        return 1;
+    }
+    return 0;
+}
+
+int SPH_trajectory_reader::read_frame(size_t frame, vector<SPH_particle>& particle_list)
+{
+    if (frame >= index.size())
+        return 1;
+
+    // continue from the frame decoded last when it lies between, otherwise from the keyframe before
+    size_t key = frame;
+    while (key > 0 && !index[key].keyframe)
+        key--;
+    if (!index[key].keyframe)
+        return 1;
+    size_t first = decoded >= long(key) && decoded <= long(frame) ? size_t(decoded + 1) : key;
+
+    vector<uint64_t> words;
+    for (size_t f = first; f <= frame; f++)
+    {
+        SPH_trajectory_frame_header head;
+        file.seekg(index[f].offset);
+        file.read(reinterpret_cast<char*>(&head), sizeof(head));
+        words.resize(head.n_bytes / sizeof(uint64_t));
+        file.read(reinterpret_cast<char*>(words.data()), head.n_bytes);
+        if (!file || (!head.keyframe && head.n_particles != state.id.size()))
+        {
+            file.clear();
+            decoded = -1;
+            return 1;
+        }
+
+        size_t n = head.n_particles;
+        bit_reader in(words);
+        int last = 0;
+        if (head.keyframe)
+        {
+            state.resize(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                state.id[i] = int((i > 0 ? state.id[i - 1] : 0) + in.get_signed(last));
+                state.boundary[i] = uint8_t(in.get(1));
+            }
+            for (int d = 0; d < 2; d++)
+            {
+                last = 0;
+                for (size_t i = 0; i < n; i++)
+                    state.q[d][i] = (i > 0 ? state.q[d][i - 1] : 0) + in.get_signed(last);
+            }
+            for (int k = 0; k < 4; k++)
+            {
+                last = 0;
+                for (size_t i = 0; i < n; i++)
+                    state.bits[k][i] = (i > 0 ? state.bits[k][i - 1] : 0) + uint32_t(in.get_signed(last));
+            }
+        }
+        else
+        {
+            for (int d = 0; d < 2; d++)
+            {
+                last = 0;
+                for (size_t i = 0; i < n; i++)
+                    state.q[d][i] += in.get_signed(last);
+            }
+            for (int k = 0; k < 4; k++)
+            {
+                last = 0;
+                for (size_t i = 0; i < n; i++)
+                    state.bits[k][i] += uint32_t(in.get_signed(last));
+            }
+        }
+
+        if (in.overrun)
+        {
+            decoded = -1;
+            return 1;
+        }
+        decoded = long(f);
+    }
+
+    size_t n = state.id.size();
+    particle_list.resize(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        SPH_particle& part = particle_list[i];
+        part.id = state.id[i];
+        part.boundary_status = state.boundary[i];
+        for (int d = 0; d < 2; d++)
+            part.x[d] = header.origin[d] + state.q[d][i] * header.quantum;
+        part.v[0] = bits_float(state.bits[0][i]);
+        part.v[1] = bits_float(state.bits[1][i]);
+        part.rho = bits_float(state.bits[2][i]);
+        part.P = bits_float(state.bits[3][i]);
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "../includes/SPH_verlet.h"
+#include "../includes/SPH_2D.h"
+
+bool SPH_verlet_list::needs_rebuild(const vector<SPH_particle>& particle_list, int num_threads) const
+{
+    if (n_builds == 0 || x0.size() != particle_list.size())
+        return true;
+
+    double max_d2 = 0;
+
+#pragma omp parallel for reduction(max:max_d2) num_threads(num_threads)
+    for (int i = 0; i < int(particle_list.size()); i++)
+    {
+        double dx = particle_list[i].x[0] - x0[i];
+        double dy = particle_list[i].x[1] - y0[i];
+        max_d2 = max(max_d2, dx * dx + dy * dy);
+    }
+
+    return max_d2 > 0.25 * skin * skin;
+}
+
+void SPH_verlet_list::build(const vector<SPH_particle>& particle_list, const SPH_cell_list& cells, const SPH_cell_list& boundary_cells,
+    int n_boundary, double h, int num_threads)
+{
+    int n = int(particle_list.size());
+    double cut_off = 2.0 * h + skin;
+    double cut_off2 = cut_off * cut_off;
+
+    // cells have size 2h, so a cut off larger than 2h reaches further than the neighbouring cells
+    int reach = int(ceil(cut_off / (2.0 * h)));
+
+    start.resize(n + 1);
+    x0.resize(n);
+    y0.resize(n);
+
+    // visit the candidates of particle i, calling found(j) for every neighbour
+    auto for_each_neighbour = [&](int i, auto found)
+    {
+        const SPH_particle& part = particle_list[i];
+        int j_lo = max(part.list_num[1] - reach, 0);
+        int j_hi = min(part.list_num[1] + reach, cells.max_list[1] - 1);
+
+        auto visit = [&](int first, int last)
+        {
+            for (int j = first; j < last; j++)
+            {
+                double dx = part.x[0] - particle_list[j].x[0];
+                double dy = part.x[1] - particle_list[j].x[1];
+                if (j != i && dx * dx + dy * dy < cut_off2)
+                    found(j);
+            }
+        };
+
+        for (int ci = max(part.list_num[0] - reach, 0); ci <= min(part.list_num[0] + reach, cells.max_list[0] - 1); ci++)
+        {
+            cells.column_ranges(ci, j_lo, j_hi, visit);
+            if (i >= n_boundary)
+                boundary_cells.column_ranges(ci, j_lo, j_hi, visit);
+        }
+    };
+
+    // first pass counts the neighbours of every particle
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads)
+    for (int i = 0; i < n; i++)
+    {
+        int count = 0;
+        for_each_neighbour(i, [&count](int) { count++; });
+        start[i + 1] = count;
+
+        x0[i] = particle_list[i].x[0];
+        y0[i] = particle_list[i].x[1];
+    }
+
+    start[0] = 0;
+    for (int i = 0; i < n; i++)
+        start[i + 1] += start[i];
+
+    // second pass writes the neighbours at their final place
+    neighbours.resize(start[n]);
+
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads)
+    for (int i = 0; i < n; i++)
+    {
+        int pos = start[i];
+        for_each_neighbour(i, [&](int j) { neighbours[pos++] = j; });
+    }
+
+    n_builds++;
+}
@@ -1,12 +1,14 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <cstring>
 
 #include "../includes/file_writer.h"
 
 std::string scalar_to_string(const char* name,
 			     std::vector<SPH_particle> *particle_list,
-			     double (*func)(SPH_particle)) {
+			     double (*func)(const SPH_particle&)) {
 
   /**
      Return scalar variable from function func as string of named
@@ -35,7 +37,7 @@ std::string scalar_to_string(const char* name,
 
 std::string vector_to_string(const char* name,
 			     std::vector<SPH_particle> *particle_list,
-			     double (*func)(SPH_particle, int)) {
+			     double (*func)(const SPH_particle&, int)) {
 
   /**
      Return vector variable from function func as string of named
@@ -86,17 +88,17 @@ std::string range_as_string(int n, int offset) {
   return  s;
 }
 
-double get_velocity(SPH_particle p, int i) {
+double get_velocity(const SPH_particle& p, int i) {
   /* Return ith element of velocity for particle p */
   return p.v[i];
 }
 
-double get_position(SPH_particle p, int i) {
+double get_position(const SPH_particle& p, int i) {
   /* Return ith element of position for particle p */
   return p.x[i];
 }
 
-double get_pressure(SPH_particle p) {
+double get_pressure(const SPH_particle& p) {
   /* Return pressure for particle p */
   return p.P;
 }
@@ -142,3 +144,206 @@ int write_file(const char *filename,
 
   return 0;
 }
+
+class appended_stream {
+
+  /**
+     Buffered writer for the blocks of a VTK AppendedData section, either
+     as raw bytes or base64 encoded, so that no intermediate strings are
+     built.
+  */
+
+public:
+  appended_stream(std::fstream& fs, bool base64) : fs(fs), base64(base64) {}
+
+  ~appended_stream() { flush(); }
+
+  template <class T>
+  void put(T value) {
+    /* Append one value to the current block */
+    write(&value, sizeof(T));
+  }
+
+  void end_block() {
+    /* Finish a block, base64 encodes every block separately */
+    if (base64 && n_carry > 0) {
+      unsigned char in[3] = {0, 0, 0};
+      std::memcpy(in, carry, n_carry);
+      encode(in);
+      for (int i = n_carry + 1; i < 4; ++i) buffer[n_buffer - 4 + i] = '=';
+      n_carry = 0;
+    }
+  }
+
+  void flush() {
+    fs.write(buffer, n_buffer);
+    n_buffer = 0;
+  }
+
+  static uint64_t encoded_size(uint64_t n_bytes, bool base64) {
+    /* Number of characters a block of n_bytes takes in the file */
+    return base64 ? 4 * ((n_bytes + 2) / 3) : n_bytes;
+  }
+
+private:
+  static constexpr int buffer_size = 1 << 16;
+
+  std::fstream& fs;
+  bool base64;
+  char buffer[buffer_size];
+  int n_buffer = 0;
+  unsigned char carry[3];
+  int n_carry = 0;
+
+  void write(const void* data, size_t n) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    if (!base64) {
+      if (n_buffer + int(n) > buffer_size) flush();
+      std::memcpy(buffer + n_buffer, bytes, n);
+      n_buffer += n;
+      return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      carry[n_carry++] = bytes[i];
+      if (n_carry == 3) {
+        encode(carry);
+        n_carry = 0;
+      }
+    }
+  }
+
+  void encode(const unsigned char* in) {
+    static const char table[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    if (n_buffer + 4 > buffer_size) flush();
+    buffer[n_buffer++] = table[in[0] >> 2];
+    buffer[n_buffer++] = table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+    buffer[n_buffer++] = table[((in[1] & 0x0f) << 2) | (in[2] >> 6)];
+    buffer[n_buffer++] = table[in[2] & 0x3f];
+  }
+};
+
+
+int write_file_binary(const char *filename,
+		      std::vector<SPH_particle> *particle_list,
+		      int fields, bool base64) {
+
+  /*
+
+    Write VTK XMLPolyData (.vtp) file containing data in particle_list,
+    with all arrays in a single raw (or base64 encoded) AppendedData
+    section. Values are streamed straight from the particles, as Float32
+    for the fields and points and Int32 for the vertex topology.
+
+    @param[in] filename Filename to write to
+    @param[in] particle_list Particle list to output
+    @param[in] fields Point data arrays to write, combination of vtk_field
+    @param[in] base64 Whether to base64 encode the appended data
+
+   */
+
+  const uint64_t n = particle_list->size();
+
+  // declare the arrays in the order their blocks follow in the appended data
+  struct array_info { const char* tag; uint64_t n_bytes; };
+  std::vector<array_info> arrays;
+
+  if (fields & VTK_PRESSURE)
+    arrays.push_back({"type=\"Float32\" Name=\"Pressure\"", n * sizeof(float)});
+  if (fields & VTK_VELOCITY)
+    arrays.push_back({"type=\"Float32\" Name=\"Velocity\" NumberOfComponents=\"3\"", 3 * n * sizeof(float)});
+  if (fields & VTK_DENSITY)
+    arrays.push_back({"type=\"Float32\" Name=\"Density\"", n * sizeof(float)});
+  if (fields & VTK_BOUNDARY)
+    arrays.push_back({"type=\"UInt8\" Name=\"Boundary\"", n * sizeof(uint8_t)});
+  int n_point_data = arrays.size();
+  arrays.push_back({"type=\"Float32\" Name=\"Points\" NumberOfComponents=\"3\"", 3 * n * sizeof(float)});
+  arrays.push_back({"type=\"Int32\" Name=\"connectivity\"", n * sizeof(int32_t)});
+  arrays.push_back({"type=\"Int32\" Name=\"offsets\"", n * sizeof(int32_t)});
+
+  // every block is a UInt64 byte count followed by the data
+  std::vector<uint64_t> offsets(arrays.size());
+  uint64_t offset = 0;
+  for (size_t k = 0; k < arrays.size(); ++k) {
+    offsets[k] = offset;
+    offset += appended_stream::encoded_size(sizeof(uint64_t) + arrays[k].n_bytes, base64);
+  }
+
+  auto declare = [&](std::fstream& fs, size_t k) {
+    fs << "<DataArray " << arrays[k].tag << " format=\"appended\" offset=\"" << offsets[k] << "\"/>\n";
+  };
+
+  std::fstream fs(filename, std::fstream::out | std::fstream::binary);
+
+  fs << "<?xml version=\"1.0\"?>\n";
+  fs << "<VTKFile type=\"PolyData\" version=\"1.0\" byte_order=\"LittleEndian\" header_type=\"UInt64\">\n";
+  fs << "<PolyData>\n";
+  fs << "<Piece NumberOfPoints=\""<< n << "\" NumberOfVerts=\"" << n <<"\" NumberOfLines=\"0\" NumberOfStrips=\"0\" NumberOfPolys=\"0\">\n";
+  fs << "<PointData>\n";
+  for (int k = 0; k < n_point_data; ++k) declare(fs, k);
+  fs << "</PointData>\n";
+  fs << "<Points>\n";
+  declare(fs, n_point_data);
+  fs << "</Points>\n";
+  fs << "<Verts>\n";
+  declare(fs, n_point_data + 1);
+  declare(fs, n_point_data + 2);
+  fs << "</Verts>\n";
+  fs << "</Piece>\n";
+  fs << "</PolyData>\n";
+  fs << "<AppendedData encoding=\"" << (base64 ? "base64" : "raw") << "\">\n";
+  fs << "_";
+
+  {
+    appended_stream out(fs, base64);
+    size_t k = 0;
+
+    if (fields & VTK_PRESSURE) {
+      out.put(arrays[k++].n_bytes);
+      for (const SPH_particle& p : *particle_list) out.put(float(p.P));
+      out.end_block();
+    }
+    if (fields & VTK_VELOCITY) {
+      out.put(arrays[k++].n_bytes);
+      for (const SPH_particle& p : *particle_list) {
+        out.put(float(p.v[0]));
+        out.put(float(p.v[1]));
+        out.put(0.0f);
+      }
+      out.end_block();
+    }
+    if (fields & VTK_DENSITY) {
+      out.put(arrays[k++].n_bytes);
+      for (const SPH_particle& p : *particle_list) out.put(float(p.rho));
+      out.end_block();
+    }
+    if (fields & VTK_BOUNDARY) {
+      out.put(arrays[k++].n_bytes);
+      for (const SPH_particle& p : *particle_list) out.put(uint8_t(p.boundary_status));
+      out.end_block();
+    }
+
+    out.put(arrays[k++].n_bytes);
+    for (const SPH_particle& p : *particle_list) {
+      out.put(float(p.x[0]));
+      out.put(float(p.x[1]));
+      out.put(0.0f);
+    }
+    out.end_block();
+
+    out.put(arrays[k++].n_bytes);
+    for (uint64_t i = 0; i < n; ++i) out.put(int32_t(i));
+    out.end_block();
+
+    out.put(arrays[k++].n_bytes);
+    for (uint64_t i = 0; i < n; ++i) out.put(int32_t(i + 1));
+    out.end_block();
+  }
+
+  fs << "\n</AppendedData>\n";
+  fs << "</VTKFile>\n";
+  fs.flush();
+  fs.close();
+
+  return 0;
+}
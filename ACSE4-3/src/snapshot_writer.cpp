@@ -0,0 +1,92 @@
+#include <filesystem>
+#include "../includes/snapshot_writer.h"
+
+SPH_snapshot_writer::SPH_snapshot_writer(int max_pending, int fields)
+    : max_pending(max_pending), fields(fields)
+{
+    worker = thread(&SPH_snapshot_writer::run, this);
+}
+
+SPH_snapshot_writer::~SPH_snapshot_writer()
+{
+    {
+        unique_lock<mutex> guard(lock);
+        stop = true;
+    }
+    changed.notify_all();
+    worker.join();
+}
+
+void SPH_snapshot_writer::submit(const string& filename, const vector<SPH_particle>& particle_list, double time, int step)
+{
+    unique_lock<mutex> guard(lock);
+
+    // only block when the writer is more than max_pending frames behind
+    if (int(queue.size()) >= max_pending)
+    {
+        stalls++;
+        changed.wait(guard, [this] { return int(queue.size()) < max_pending; });
+    }
+
+    snapshot frame;
+    frame.filename = filename;
+    frame.time = time;
+    frame.step = step;
+    if (!free_buffers.empty())
+    {
+        frame.particles.swap(free_buffers.back());
+        free_buffers.pop_back();
+    }
+
+    // copying into a buffer that has been used before does not allocate
+    guard.unlock();
+    frame.particles.assign(particle_list.begin(), particle_list.end());
+    guard.lock();
+
+    queue.push_back(move(frame));
+    changed.notify_all();
+}
+
+void SPH_snapshot_writer::finish()
+{
+    unique_lock<mutex> guard(lock);
+    changed.wait(guard, [this] { return queue.empty() && !busy; });
+}
+
+void SPH_snapshot_writer::run()
+{
+    unique_lock<mutex> guard(lock);
+
+    while (true)
+    {
+        changed.wait(guard, [this] { return stop || !queue.empty(); });
+        if (queue.empty())
+            return;
+
+        snapshot frame = move(queue.front());
+        queue.pop_front();
+        busy = true;
+        changed.notify_all();
+
+        // write without holding the lock, so the time stepping can queue the next frame
+        guard.unlock();
+        uint64_t bytes;
+        if (trajectory)
+            bytes = trajectory->write_frame(frame.particles, frame.time, frame.step);
+        else
+        {
+            write_file_binary(frame.filename.c_str(), &frame.particles, fields);
+            error_code error;
+            uintmax_t size = filesystem::file_size(frame.filename, error);
+            bytes = error ? 0 : size;
+        }
+        guard.lock();
+
+        bytes_written += bytes;
+
+        free_buffers.push_back(move(frame.particles));
+        frames_written++;
+        busy = false;
+        changed.notify_all();
+    }
+}
@@ -1,7 +1,7 @@
 import vtk
 import numpy as np
 
-int size = 10
+size = 10
 
 def test_file_writer_output():
     reader = vtk.vtkXMLPolyDataReader()
@@ -20,11 +20,11 @@ def test_boundaries():
 
     pdata = reader.GetOutput()
     for i in range(pdata.GetNumberOfPoints()):
-            v = 0
-            for j in range(2):
-                    assert (pdate.GetPoint(i)[j] >= 0 and pdata.GetPoint(i)[j] < size)
-                    v += pdate.GetPointData().GetArray('Velocity').GetTuple(i)[j] ** 2
-                assert np.sqrt(v) < 20
+        v = 0
+        for j in range(2):
+            assert (pdata.GetPoint(i)[j] >= 0 and pdata.GetPoint(i)[j] < size)
+            v += pdata.GetPointData().GetArray('Velocity').GetTuple(i)[j] ** 2
+        assert np.sqrt(v) < 20
 
 
 def test_velocity():
@@ -34,11 +34,11 @@ def test_velocity():
 
     pdata = reader.GetOutput()
     for i in range(pdata.GetNumberOfPoints()):
-            v = 0
-            for j in range(2):
-                    assert (pdate.GetPoint(i)[j] >= 0 and pdata.GetPoint(i)[j] < size)
-                    v += pdate.GetPointData().GetArray('Velocity').GetTuple(i)[j] ** 2
-                assert v < 1498
+        v = 0
+        for j in range(2):
+            assert (pdata.GetPoint(i)[j] >= 0 and pdata.GetPoint(i)[j] < size)
+            v += pdata.GetPointData().GetArray('Velocity').GetTuple(i)[j] ** 2
+        assert v < 1498
 
 def test_pressure():
     reader = vtk.vtkXMLPolyDataReader()
@@ -1,11 +1,11 @@
-#include "SPH_2D.h"
-#include "file_writer.h"
+#include "../includes/SPH_2D.h"
+#include "../includes/file_writer.h"
 
 SPH_main domain;
 
 int main(void)
 {
-	domain.set_values();										//Set simulation parameters
+	domain.set_values(1.3, 0.2, 1.0);									//Set simulation parameters
 	domain.initialise_grid();									//initialise simulation grid
 
 	domain.place_points(domain.min_x,domain.max_x);				//places initial points - will need to be modified to include boundary points and the specifics of where the fluid is in the domain
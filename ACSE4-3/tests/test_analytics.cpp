@@ -0,0 +1,70 @@
+#include <cmath>
+#include "../includes/SPH_2D.h"
+#include "../includes/SPH_analytics.h"
+
+static SPH_particle make(double x, double y, double vx, double vy, double rho, bool boundary) {
+  SPH_particle part;
+  part.x[0] = x;
+  part.x[1] = y;
+  part.v[0] = vx;
+  part.v[1] = vy;
+  part.rho = rho;
+  part.calculate_P();
+  part.boundary_status = boundary;
+  return part;
+}
+
+int main() {
+  SPH_main domain;
+  domain.set_values(1.3, 0.2, 1.0);
+
+  domain.particle_list.push_back(make(1.0, 3.0, 3.0, 4.0, rho0, false));
+  domain.particle_list.push_back(make(5.0, 1.0, 0.0, 0.0, 1.05 * rho0, false));
+  domain.particle_list.push_back(make(20.1, 1.0, 0.0, 0.0, 1.01 * rho0, true));
+  domain.particle_list.push_back(make(20.3, 1.0, 0.0, 0.0, 1.02 * rho0, true));
+
+  // a ghost is counted by the process owning it
+  domain.particle_list.push_back(make(9.0, 4.0, 10.0, 0.0, rho0, false));
+  domain.particle_list.back().ghost = true;
+
+  SPH_analytics analytics;
+  analytics.enabled = true;
+  analytics.record(domain, 0.1, 1);
+
+  double mass = 0.2 * 0.2 * rho0;
+  if (std::fabs(analytics.kinetic_energy - 0.5 * mass * 25) > 1e-9) return 1;
+  if (std::fabs(analytics.max_velocity - 5) > 1e-12) return 1;
+
+  // only the fluid above the water ahead of the dam makes the front
+  if (analytics.surge_front != 1.0) return 1;
+
+  // only the first column behind the wall
+  const SPH_particle& wall = domain.particle_list[2];
+  if (std::fabs(analytics.wall_force - wall.P * 0.2) > 1e-9) return 1;
+  if (analytics.wall_max_pressure != wall.P) return 1;
+
+  // errors of 0 and 0.05 in bins of 0.02
+  if (analytics.density_error[0] != 1 || analytics.density_error[2] != 1) return 1;
+  double total = 0;
+  for (double count : analytics.density_error) total += count;
+  if (total != 2) return 1;
+
+  // nothing is computed between two rows
+  analytics.interval = 2;
+  domain.particle_list[0].v[0] = 0;
+  analytics.record(domain, 0.2, 3);
+  if (std::fabs(analytics.max_velocity - 5) > 1e-12) return 1;
+
+  // the acceleration of a ghost misses the particles beyond the halo, so only its owner takes its time step limits
+  for (SPH_particle& part : domain.particle_list) part.a[0] = part.a[1] = 0;
+  SPH_particle& ghost = domain.particle_list.back();
+  ghost.a[0] = 1e6;
+  ghost.rho = 2 * rho0;
+  double force, acoustic, owned_force, owned_acoustic;
+  domain.particle_limits(force, acoustic);
+  ghost.ghost = false;
+  domain.particle_limits(owned_force, owned_acoustic);
+  if (force != SPH_time_step::force_limit(domain.h, 0) || !(owned_force < force)) return 1;
+  if (!(owned_acoustic < acoustic)) return 1;
+  return 0;
+}
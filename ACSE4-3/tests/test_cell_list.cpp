@@ -0,0 +1,105 @@
+#include <random>
+#include "../includes/SPH_2D.h"
+
+// particles in a few clusters of a tall grid of 40 x 4000 cells, most of it empty
+static std::vector<SPH_particle> clusters(int n, double h) {
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<double> u(0, 1);
+  double min_x[2] = { 0, 0 };
+  std::vector<SPH_particle> particle_list(n);
+  for (int i = 0; i < n; i++) {
+    SPH_particle& part = particle_list[i];
+    double cx = 10 + 20 * (i % 3), cy = 100 + 5000 * (i % 4);
+    part.x[0] = cx + 8 * u(rng);
+    part.x[1] = cy + 8 * u(rng);
+    part.id = i;
+    part.calc_index(min_x, h);
+  }
+  return particle_list;
+}
+
+static int compare(SPH_cell_order order) {
+  const int nx = 40, ny = 4000, n = 5000;
+  const double h = 1.0;
+
+  SPH_cell_list dense, sparse, automatic;
+  dense.initialise(nx, ny, order, SPH_CELLS_DENSE);
+  sparse.initialise(nx, ny, order, SPH_CELLS_SPARSE);
+  automatic.initialise(nx, ny, order, SPH_CELLS_AUTO);
+  if (dense.sparse || !sparse.sparse || automatic.sparse) return 1;
+
+  std::vector<SPH_particle> a = clusters(n, h), b = a, c = a;
+
+  // sort only the particles behind the first 100, the others keep their place
+  for (int build = 0; build < 2; build++) {
+    dense.build(a, 100);
+    sparse.build(b, 100);
+    automatic.build(c, 100);
+  }
+
+  // the occupancy is far below 2 %, so the automatic storage has switched to the hash
+  if (!automatic.sparse || sparse.occupied != dense.occupied || dense.occupied == 0) return 1;
+  if (!(sparse.memory() * 10 < dense.memory())) return 1;
+  if (sparse.max_count() != dense.max_count()) return 1;
+
+  for (int i = 0; i < n; i++)
+    if (a[i].id != b[i].id || a[i].id != c[i].id || a[i].grid_index != b[i].grid_index) return 1;
+
+  for (int ci = 0; ci < nx; ci++)
+    for (int cj = 0; cj < ny; cj++) {
+      int count = dense.end(ci, cj) - dense.begin(ci, cj);
+      if (sparse.end(ci, cj) - sparse.begin(ci, cj) != count) return 1;
+      if (count > 0 && (sparse.begin(ci, cj) != dense.begin(ci, cj) || automatic.begin(ci, cj) != dense.begin(ci, cj))) return 1;
+    }
+
+  // column_ranges visits the same particles
+  for (int ci = 0; ci < nx; ci++) {
+    long sum_dense = 0, sum_sparse = 0;
+    dense.column_ranges(ci, 0, ny - 1, [&](int first, int last) { for (int m = first; m < last; m++) sum_dense += m + 1; });
+    sparse.column_ranges(ci, 0, ny - 1, [&](int first, int last) { for (int m = first; m < last; m++) sum_sparse += m + 1; });
+    if (sum_dense != sum_sparse) return 1;
+  }
+
+  // filling the grid switches the automatic storage back
+  std::vector<SPH_particle> full(nx * ny);
+  double min_x[2] = { 0, 0 };
+  for (int i = 0; i < nx * ny; i++) {
+    full[i].x[0] = 2 * h * (i / ny) + h;
+    full[i].x[1] = 2 * h * (i % ny) + h;
+    full[i].calc_index(min_x, h);
+  }
+  automatic.build(full);
+  if (automatic.sparse || automatic.end(3, 7) - automatic.begin(3, 7) != 1) return 1;
+  if (order == SPH_ORDER_ROWS && automatic.begin(3, 7) != 3 * ny + 7) return 1;
+  if (automatic.max_count() != 1) return 1;
+  return 0;
+}
+
+int main() {
+  if (compare(SPH_ORDER_ROWS)) return 1;
+  if (compare(SPH_ORDER_MORTON)) return 1;
+  if (compare(SPH_ORDER_HILBERT)) return 1;
+
+  // the whole simulation is the same with either storage
+  double sums[2][3];
+  for (int s = 0; s < 2; s++) {
+    SPH_main domain;
+    domain.use_soa = true;
+    domain.cell_storage = s == 0 ? SPH_CELLS_DENSE : SPH_CELLS_SPARSE;
+    domain.set_values(1.3, 0.2, 1.0);
+    domain.initialise_grid();
+    domain.place_points(domain.min_x, domain.max_x);
+    for (int step = 0; step < 20; step++)
+      domain.forward_euler(step % 10 == 0, true);
+    sums[s][0] = sums[s][1] = sums[s][2] = 0;
+    for (const SPH_particle& part : domain.particle_list) {
+      sums[s][0] += part.x[0];
+      sums[s][1] += part.v[1];
+      sums[s][2] += part.rho;
+    }
+  }
+  for (int f = 0; f < 3; f++)
+    if (sums[0][f] != sums[1][f]) return 1;
+
+  return 0;
+}
@@ -0,0 +1,50 @@
+#include <cstring>
+#include "../includes/SPH_2D.h"
+#include "../includes/SPH_checkpoint.h"
+
+// run steps from cnt on, smoothing every 20 steps like the driver
+void run(SPH_main& domain, int cnt, int steps) {
+  for (int c = cnt; c < cnt + steps; c++)
+    domain.predictor_corrector(c % 20 == 0);
+}
+
+int main() {
+  SPH_main reference;
+  reference.set_values(1.3, 0.25, 1.0);
+  reference.initialise_grid();
+  reference.place_points(reference.min_x, reference.max_x);
+  reference.allocate_to_grid();
+  run(reference, 0, 30);
+
+  if (write_checkpoint("tests/test_checkpoint.sph", reference, 0.5, 30)) return 1;
+  run(reference, 30, 30);
+
+  // a run restarted from the checkpoint has to follow the same path bit for bit
+  SPH_main restarted;
+  double time;
+  int cnt;
+  if (read_checkpoint("tests/test_checkpoint.sph", restarted, time, cnt)) return 1;
+  if (time != 0.5 || cnt != 30) return 1;
+  if (restarted.h != reference.h || restarted.max_list[0] != reference.max_list[0]) return 1;
+  run(restarted, cnt, 30);
+
+  if (restarted.particle_list.size() != reference.particle_list.size()) return 1;
+  for (size_t i = 0; i < reference.particle_list.size(); i++) {
+    const SPH_particle& a = reference.particle_list[i];
+    const SPH_particle& b = restarted.particle_list[i];
+    if (std::memcmp(a.x, b.x, sizeof(a.x)) || std::memcmp(a.v, b.v, sizeof(a.v)) || a.rho != b.rho) return 1;
+  }
+  if (restarted.delta_t != reference.delta_t) return 1;
+
+  // the predictor state lives only within a step, so it is neither saved nor allocated by forward Euler
+  SPH_main euler;
+  if (read_checkpoint("tests/test_checkpoint.sph", euler, time, cnt)) return 1;
+  if (!euler.prev_rho.empty()) return 1;
+  euler.forward_euler();
+  if (!euler.prev_rho.empty() || !euler.prev_x[0].empty()) return 1;
+  if (restarted.prev_rho.size() != restarted.particle_list.size()) return 1;
+
+  // a file of the wrong size is rejected
+  if (!read_checkpoint("tests/test_checkpoint.cpp", restarted, time, cnt)) return 1;
+  return 0;
+}
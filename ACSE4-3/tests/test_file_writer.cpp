@@ -1,5 +1,5 @@
-#include "SPH_2D.h"
-#include "file_writer.h"
+#include "../includes/SPH_2D.h"
+#include "../includes/file_writer.h"
 
 int main() {
 
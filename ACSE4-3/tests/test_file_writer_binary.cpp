@@ -0,0 +1,78 @@
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdint>
+#include "../includes/SPH_2D.h"
+#include "../includes/file_writer.h"
+
+// decode base64 text, stopping at the first character outside the alphabet
+std::string decode_base64(const std::string& text) {
+  std::string out;
+  int bits = 0, value = 0;
+  for (char c : text) {
+    const char* table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const char* pos = std::strchr(table, c);
+    if (c == '=') { bits = 0; value = 0; continue; }
+    if (c == 0 || pos == nullptr) break;
+    value = (value << 6) | int(pos - table);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out += char((value >> bits) & 0xff);
+    }
+  }
+  return out;
+}
+
+// read back the appended section of a file written by write_file_binary
+std::string appended_data(const char* filename, bool base64) {
+  std::ifstream fs(filename, std::ios::binary);
+  std::stringstream ss;
+  ss << fs.rdbuf();
+  std::string s = ss.str();
+  size_t start = s.find('_', s.find("<AppendedData")) + 1;
+  std::string data = s.substr(start, s.rfind("\n</AppendedData>") - start);
+  return base64 ? decode_base64(data) : data;
+}
+
+int check(const char* filename, bool base64) {
+  std::vector<SPH_particle> particle_list(10);
+  for (int i = 0; i < 10; i++) {
+    particle_list[i].x[0] = i;
+    particle_list[i].x[1] = -i;
+    particle_list[i].v[0] = 2 * i;
+    particle_list[i].v[1] = 3 * i;
+    particle_list[i].P = i;
+  }
+
+  write_file_binary(filename, &particle_list, VTK_PRESSURE | VTK_VELOCITY, base64);
+  std::string data = appended_data(filename, base64);
+
+  // pressure, velocity, points, connectivity and offsets blocks
+  if (data.size() != 5 * sizeof(uint64_t) + 10 * (1 + 3 + 3 + 1 + 1) * 4) return 1;
+
+  const char* p = data.data();
+  uint64_t n_bytes;
+  std::memcpy(&n_bytes, p, 8);
+  if (n_bytes != 10 * sizeof(float)) return 1;
+
+  for (int i = 0; i < 10; i++) {
+    float P;
+    std::memcpy(&P, p + 8 + 4 * i, 4);
+    if (P != i) return 1;
+  }
+
+  // second component of velocity of the last particle
+  p += 8 + 10 * 4;
+  float v;
+  std::memcpy(&v, p + 8 + (3 * 9 + 1) * 4, 4);
+  if (v != 27) return 1;
+
+  return 0;
+}
+
+int main() {
+  if (check("tests/test_file_writer_binary.vtp", false)) return 1;
+  if (check("tests/test_file_writer_base64.vtp", true)) return 1;
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include <cstdio>
+#include <fstream>
+#include "../includes/SPH_2D.h"
+
+static int write(const char* filename, const char* text) {
+  std::ofstream fs(filename);
+  fs << text;
+  return !fs;
+}
+
+int main() {
+  const char* filename = "test_geometry.txt";
+
+  // the file version of the built-in dam break places the same particles in the same order
+  if (write(filename,
+            "# dam break\n"
+            "domain 0 0 20 10\n"
+            "boundary box 0 0 20 10 layers 6\n"
+            "fluid box 0 0 20 10\n"
+            "empty box 0 5 20 10   # air above the water\n"
+            "empty box 3 2 20 5\n")) return 1;
+
+  SPH_main reference;
+  reference.set_values(1.3, 0.2, 1.0);
+  reference.initialise_grid();
+  reference.place_points(reference.min_x, reference.max_x);
+
+  SPH_geometry geometry;
+  if (geometry.read(filename)) return 1;
+  SPH_main domain;
+  domain.num_threads = 2;
+  domain.set_values(1.3, 0.2, 1.0);
+  geometry.apply_domain(domain);
+  domain.initialise_grid();
+  domain.place_points(geometry, domain.min_x, domain.max_x);
+
+  if (domain.particle_list.size() != reference.particle_list.size()) return 1;
+  for (size_t i = 0; i < domain.particle_list.size(); i++) {
+    const SPH_particle& a = domain.particle_list[i];
+    const SPH_particle& b = reference.particle_list[i];
+    if (a.x[0] != b.x[0] || a.x[1] != b.x[1] || a.boundary_status != b.boundary_status) return 1;
+    if (a.list_num[0] != b.list_num[0] || a.list_num[1] != b.list_num[1]) return 1;
+  }
+
+  // a triangle of fluid in a wall of 2 layers, on a lattice of spacing 1 from (-3, -3) to (5, 5)
+  if (write(filename,
+            "domain 0 0 2 2\n"
+            "boundary polygon 3 0 0 4 0 0 4 layers 2\n"
+            "fluid polygon 3 0 0 4 0 0 4\n")) return 1;
+  if (geometry.read(filename)) return 1;
+
+  double min[2] = { -3, -3 }, max[2] = { 5, 5 };
+  std::vector<SPH_particle> particle_list(1);
+  long placed = geometry.rasterise(particle_list, min, max, 1.0, min, 1.0, 3);
+  if (placed != long(particle_list.size()) - 1) return 1;
+
+  int fluid = 0, wall = 0;
+  for (size_t i = 1; i < particle_list.size(); i++) {
+    const SPH_particle& part = particle_list[i];
+    if (part.boundary_status) {
+      wall++;
+      if (part.x[0] + part.x[1] < 4 && part.x[0] > 0 && part.x[1] > 0) return 1;
+    } else {
+      fluid++;
+      if (part.x[0] <= 0 || part.x[1] <= 0 || part.x[0] + part.x[1] >= 4) return 1;
+    }
+  }
+  // (1, 1), (1, 2), (2, 1) strictly inside
+  if (fluid != 3 || wall == 0) return 1;
+
+  // the corner (-2, -2) is 2.8 away, (-1, -1) within 2
+  bool far_corner = false, near_corner = false;
+  for (size_t i = 1; i < particle_list.size(); i++) {
+    const SPH_particle& part = particle_list[i];
+    if (part.x[0] == -2 && part.x[1] == -2) far_corner = true;
+    if (part.x[0] == -1 && part.x[1] == -1) near_corner = true;
+  }
+  if (far_corner || !near_corner) return 1;
+
+  if (write(filename, "fluid circle 0 0 1\n")) return 1;
+  if (!geometry.read(filename)) return 1;
+
+  std::remove(filename);
+  return 0;
+}
@@ -0,0 +1,71 @@
+#include <cmath>
+#include "../includes/SPH_2D.h"
+
+struct run_result {
+  double sums[3] = { 0, 0, 0 };
+  double time = 0;
+  long computed = 0;
+  bool inside = true;
+};
+
+// dam break with a fast jet in the top left corner of the column, levels < 0 for the global time step
+static run_result run(int levels, double speed, int steps, bool predictor_corrector, SPH_cell_storage storage = SPH_CELLS_AUTO) {
+  SPH_main domain;
+  domain.cell_storage = storage;
+  domain.use_soa = true;
+  domain.use_individual_steps = levels >= 0;
+  domain.step_levels = std::max(levels, 0);
+  domain.time_step.adaptive = true;
+  domain.set_values(1.3, 0.2, 1.0);
+  domain.initialise_grid();
+  domain.place_points(domain.min_x, domain.max_x);
+  for (SPH_particle& part : domain.particle_list)
+    if (!part.boundary_status && part.x[1] > 4.0 && part.x[0] < 1.5) part.v[0] = part.v[1] = speed;
+
+  run_result result;
+  for (int step = 0; step < steps; step++) {
+    if (predictor_corrector) domain.predictor_corrector(step % 10 == 0);
+    else domain.forward_euler(step % 10 == 0);
+    result.time += domain.delta_t;
+    result.computed += levels >= 0 ? domain.n_active : long(domain.particle_list.size());
+  }
+
+  for (const SPH_particle& part : domain.particle_list) {
+    result.sums[0] += part.x[0];
+    result.sums[1] += part.v[1];
+    result.sums[2] += part.rho;
+    if (part.level < 0 || part.level > domain.step_levels) result.inside = false;
+    for (int k = 0; k < 2; k++)
+      if (!part.boundary_status && !(part.x[k] >= domain.inner_min_x[k] && part.x[k] <= domain.inner_max_x[k])) result.inside = false;
+  }
+  return result;
+}
+
+int main() {
+  // with a single level every particle is computed in every step, which is the global time step
+  for (int scheme = 0; scheme < 2; scheme++) {
+    run_result global = run(-1, 0, 30, scheme), single = run(0, 0, 30, scheme);
+    for (int f = 0; f < 3; f++)
+      if (global.sums[f] != single.sums[f]) return 1;
+    if (single.computed != global.computed) return 1;
+  }
+
+  // the quiet water takes coarser steps than the jet, so far fewer particles are computed for the same simulated time
+  for (int scheme = 0; scheme < 2; scheme++) {
+    run_result global = run(-1, 30, 60, scheme), levels = run(3, 30, 60, scheme);
+    if (!levels.inside || !global.inside) return 1;
+    if (!(levels.computed / levels.time < 0.75 * global.computed / global.time)) return 1;
+
+    // the states stay close to each other, both runs having reached about the same time
+    if (std::fabs(levels.time - global.time) > 0.2 * global.time) return 1;
+    if (std::fabs(levels.sums[2] - global.sums[2]) > 1e-3 * std::fabs(global.sums[2])) return 1;
+
+    // the finest level of every cell is kept by occupied cell, so the sparse cell list takes the same steps
+    run_result sparse = run(3, 30, 60, scheme, SPH_CELLS_SPARSE);
+    for (int f = 0; f < 3; f++)
+      if (sparse.sums[f] != levels.sums[f]) return 1;
+    if (sparse.computed != levels.computed) return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,53 @@
+#include <cmath>
+#include "../includes/SPH_kernel.h"
+
+// the 2D integral of W over its support has to be one
+template <class Kernel>
+int check_normalisation() {
+  double sum = 0, dr = 1e-4;
+  for (double r = 0.5 * dr; r < 2; r += dr)
+    sum += Kernel::norm * Kernel::w(r) * 2 * PI * r * dr;
+  return std::fabs(sum - 1) > 1e-6;
+}
+
+// dw against a central difference of w, and the fused evaluation against the separate ones
+template <class Kernel>
+int check_gradient(double tolerance) {
+  for (double q = 0.01; q < 2.2; q += 0.01) {
+    double fd = (Kernel::w(q + 1e-6) - Kernel::w(q - 1e-6)) / 2e-6;
+    if (std::fabs(Kernel::dw(q) - fd) > tolerance) return 1;
+
+    double w, dw;
+    Kernel::w_dw(q, w, dw);
+    if (std::fabs(w - Kernel::w(q)) > 1e-12 || std::fabs(dw - Kernel::dw(q)) > 1e-12) return 1;
+  }
+  return Kernel::w(2) != 0 || Kernel::dw(2) != 0;
+}
+
+// interpolation error relative to the peak of the kernel
+template <class Kernel>
+int check_table() {
+  double peak = Kernel::w(0);
+  for (double q = 0; q < 2.5; q += 0.001)
+    if (std::fabs(SPH_tabulated<Kernel>::w(q) - Kernel::w(q)) > 1e-5 * peak ||
+        std::fabs(SPH_tabulated<Kernel>::dw(q) - Kernel::dw(q)) > 1e-4 * peak) return 1;
+  return 0;
+}
+
+int main() {
+  // the normalisation only uses 8 digits of pi
+  static_assert(SPH_cubic_spline::norm > 0.4547 && SPH_cubic_spline::norm < 0.4548, "cubic spline norm");
+
+  if (check_normalisation<SPH_cubic_spline>()) return 1;
+  if (check_normalisation<SPH_wendland_c2>()) return 1;
+  if (check_normalisation<SPH_quintic_spline>()) return 1;
+
+  if (check_gradient<SPH_cubic_spline>(1e-5)) return 1;
+  if (check_gradient<SPH_wendland_c2>(1e-5)) return 1;
+  if (check_gradient<SPH_quintic_spline>(1e-4)) return 1;
+
+  if (check_table<SPH_cubic_spline>()) return 1;
+  if (check_table<SPH_wendland_c2>()) return 1;
+  if (check_table<SPH_quintic_spline>()) return 1;
+  return 0;
+}
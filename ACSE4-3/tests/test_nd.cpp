@@ -0,0 +1,109 @@
+#include <cmath>
+#include "../includes/SPH_2D.h"
+#include "../includes/SPH_nd.h"
+
+// integral of W over a 3D lattice of spacing 0.05 h
+template <class Kernel>
+static double integral_3d() {
+  const double h = 1.0, step = 0.05;
+  double sum = 0;
+  for (int i = -40; i <= 40; i++)
+    for (int j = -40; j <= 40; j++)
+      for (int k = -40; k <= 40; k++) {
+        double r = step * std::sqrt(double(i * i + j * j + k * k));
+        sum += kernel_norm<Kernel, 3>() / (h * h * h) * Kernel::w(r / h);
+      }
+  return sum * step * step * step;
+}
+
+// runs the 2D instance next to SPH_main from the same particles and compares the sums of the fields
+static int compare_2d(bool predictor_corrector) {
+  SPH_main domain;
+  domain.use_soa = true;
+  domain.set_values(1.3, 0.2, 1.0);
+  domain.initialise_grid();
+  domain.place_points(domain.min_x, domain.max_x);
+  domain.allocate_to_grid();
+
+  SPH_solver<2> solver;
+  double lower[2] = { 0, 0 }, upper[2] = { 20, 10 };
+  solver.set_values(1.3, 0.2, 1.0, lower, upper);
+  solver.initialise_grid();
+  for (const SPH_particle& part : domain.particle_list)
+    if (part.boundary_status && solver.add_particle(part.x, true)) return 1;
+  for (const SPH_particle& part : domain.particle_list)
+    if (!part.boundary_status && solver.add_particle(part.x, false)) return 1;
+
+  for (int step = 0; step < 30; step++) {
+    bool smooth = step % 20 == 0;
+    if (predictor_corrector) {
+      domain.predictor_corrector(smooth);
+      solver.predictor_corrector(smooth);
+    } else {
+      domain.forward_euler(smooth, true);
+      solver.forward_euler(smooth);
+    }
+  }
+
+  double expected[5] = { 0 }, result[5] = { 0 };
+  for (const SPH_particle& part : domain.particle_list) {
+    expected[0] += part.x[0];
+    expected[1] += part.x[1];
+    expected[2] += part.v[0];
+    expected[3] += part.v[1];
+    expected[4] += part.rho;
+  }
+  for (size_t i = 0; i < solver.size(); i++) {
+    result[0] += solver.x[0][i];
+    result[1] += solver.x[1][i];
+    result[2] += solver.v[0][i];
+    result[3] += solver.v[1][i];
+    result[4] += solver.rho[i];
+  }
+  for (int f = 0; f < 5; f++)
+    if (std::fabs(result[f] - expected[f]) > 1e-8 * (std::fabs(expected[f]) + 1)) return 1;
+  return 0;
+}
+
+int main() {
+  // the 3D normalisations integrate to one
+  if (std::fabs(integral_3d<SPH_cubic_spline>() - 1) > 1e-3) return 1;
+  if (std::fabs(integral_3d<SPH_wendland_c2>() - 1) > 1e-3) return 1;
+  if (std::fabs(integral_3d<SPH_quintic_spline>() - 1) > 1e-3) return 1;
+  if (kernel_norm<SPH_tabulated<SPH_wendland_c2>, 3>() != SPH_wendland_c2::norm3) return 1;
+
+  // in two dimensions it is the solver of SPH_main
+  if (compare_2d(false)) return 1;
+  if (compare_2d(true)) return 1;
+
+  // a small 3D dam break
+  SPH_solver<3> solver;
+  double lower[3] = { 0, 0, 0 }, upper[3] = { 1, 0.4, 0.6 };
+  double fluid_lower[3] = { 0, 0, 0 }, fluid_upper[3] = { 0.3, 0.4, 0.4 };
+  solver.set_values(1.3, 0.05, 1.0, lower, upper);
+  solver.initialise_grid();
+  if (solver.place_points(fluid_lower, fluid_upper) != long(solver.size())) return 1;
+
+  int n_fluid = int(solver.size()) - solver.n_boundary;
+  if (n_fluid != 6 * 8 * 8 || solver.n_boundary == 0) return 1;
+
+  double height = 0;
+  for (int i = solver.n_boundary; i < int(solver.size()); i++)
+    height += solver.x[2][i] / n_fluid;
+
+  for (int step = 0; step < 200; step++)
+    solver.forward_euler(step % 20 == 0);
+
+  double fallen = 0;
+  for (int i = solver.n_boundary; i < int(solver.size()); i++) {
+    fallen += solver.x[2][i] / n_fluid;
+    for (int k = 0; k < 3; k++)
+      if (solver.x[k][i] < lower[k] || solver.x[k][i] > upper[k]) return 1;
+    if (std::fabs(solver.rho[i] - rho0) > 0.05 * rho0) return 1;
+  }
+
+  // the column has started to collapse
+  if (!(fallen < height) || !(solver.kinetic_energy() > 0) || solver.pairs == 0) return 1;
+
+  return 0;
+}
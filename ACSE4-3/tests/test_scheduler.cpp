@@ -0,0 +1,138 @@
+#include <chrono>
+#include <thread>
+#include "../includes/SPH_2D.h"
+
+// every task is run exactly once, whatever the estimate
+static int run_all(int n_tasks, int n_threads, bool skewed, long& steals) {
+  std::vector<double> cost(n_tasks, 1.0);
+  std::vector<std::atomic<int>> runs(n_tasks);
+  for (auto& r : runs) r = 0;
+
+  SPH_work_stealing scheduler;
+  scheduler.plan(cost, n_threads);
+
+#pragma omp parallel num_threads(n_threads)
+  scheduler.work(SPH_work_stealing::worker_id(), [&](int task) {
+    runs[task]++;
+    // the estimate is wrong, the first quarter of the tasks is much slower than the rest
+    if (skewed && task < n_tasks / 4) std::this_thread::sleep_for(std::chrono::microseconds(200));
+  });
+
+  steals = scheduler.steals;
+  for (auto& r : runs)
+    if (r != 1) return 1;
+  return 0;
+}
+
+// a chain of blocks, each task waiting for its neighbours in the phase before, as in the pipelined step
+static int run_graph(int n_blocks, int n_phases, int n_threads) {
+  SPH_task_graph graph;
+  graph.clear(n_blocks * n_phases);
+  for (int p = 1; p < n_phases; p++)
+    for (int b = 0; b < n_blocks; b++)
+      for (int nb = std::max(b - 1, 0); nb <= std::min(b + 1, n_blocks - 1); nb++) graph.depend(p * n_blocks + b, (p - 1) * n_blocks + nb);
+  graph.prepare();
+
+  std::vector<std::atomic<int>> runs(n_blocks * n_phases);
+  for (auto& r : runs) r = 0;
+  std::atomic<int> violations(0);
+
+#pragma omp parallel num_threads(n_threads)
+  graph.work([&](int t) {
+    int p = t / n_blocks, b = t % n_blocks;
+    if (p > 0)
+      for (int nb = std::max(b - 1, 0); nb <= std::min(b + 1, n_blocks - 1); nb++)
+        if (runs[(p - 1) * n_blocks + nb] != 1) violations++;
+    runs[t]++;
+  });
+
+  for (auto& r : runs)
+    if (r != 1) return 1;
+  return violations != 0;
+}
+
+static double sum_fields(SPH_main& domain) {
+  double sum = 0;
+  for (const SPH_particle& part : domain.particle_list) sum += part.x[0] + part.x[1] + part.v[0] + part.v[1] + part.rho;
+  return sum;
+}
+
+int main() {
+  long steals = 0;
+  for (int threads : { 1, 2, 3, 4 })
+    for (int n : { 0, 1, 5, 97, 1000 })
+      if (run_all(n, threads, false, steals)) return 1;
+
+  // the threads given the fast tasks take over the slow ones
+  if (run_all(200, 4, true, steals) || steals == 0) return 1;
+
+  // the plan follows the estimate, the expensive task gets a worker of its own
+  SPH_work_stealing scheduler;
+  std::vector<double> cost = { 1, 1, 100, 1, 1, 1 };
+  for (int w : { 1, 2 }) {
+    int first = -1;
+    scheduler.plan(cost, 3);
+    scheduler.work(w, [&first](int t) { if (first < 0) first = t; });
+    if (first != w + 1) return 1;
+  }
+
+  // the tiled sweep gives the same particles as the plain one
+  double sums[2];
+  for (int stealing = 0; stealing < 2; stealing++) {
+    SPH_main domain;
+    domain.use_soa = true;
+    domain.use_work_stealing = stealing;
+    domain.num_threads = 3;
+    domain.time_step.adaptive = true;
+    domain.set_values(1.3, 0.2, 1.0);
+    domain.initialise_grid();
+    domain.place_points(domain.min_x, domain.max_x);
+    for (int step = 0; step < 20; step++) domain.predictor_corrector(step % 10 == 0);
+    sums[stealing] = sum_fields(domain);
+    if (stealing) {
+      long pairs = 0;
+      for (long p : domain.tile_pairs) pairs += p;
+      if (pairs == 0) return 1;
+    }
+  }
+  if (sums[0] != sums[1]) return 1;
+
+  for (int threads : { 1, 2, 4 })
+    for (int n : { 1, 2, 7, 50 })
+      if (run_graph(n, 5, threads)) return 1;
+
+  // the pipelined steps give the same particles as the plain ones, with either scheme
+  for (int scheme = 0; scheme < 2; scheme++) {
+    for (int pipeline = 0; pipeline < 2; pipeline++) {
+      SPH_main domain;
+      domain.use_soa = true;
+      domain.use_pipeline = pipeline;
+      domain.block_columns = 2;
+      domain.num_threads = 4;
+      domain.time_step.adaptive = scheme == 1;
+      domain.set_values(1.3, 0.2, 1.0);
+      domain.initialise_grid();
+      domain.place_points(domain.min_x, domain.max_x);
+      for (int step = 0; step < 30; step++) {
+        if (scheme) domain.predictor_corrector(step % 10 == 0);
+        else domain.forward_euler(step % 10 == 0);
+      }
+      sums[pipeline] = sum_fields(domain);
+
+      // the last steps ran as a graph, and no particle left the blocks next to its own
+      if (pipeline && !domain.pipeline_sorted) return 1;
+    }
+    if (sums[0] != sums[1]) return 1;
+  }
+
+  // a global reduction of the time step, as set by MPI, is never called from a task of the graph
+  SPH_main reduced;
+  reduced.use_soa = true;
+  reduced.use_pipeline = true;
+  reduced.time_step.reduce_min = [](double dt) { return dt; };
+  if (reduced.pipeline_supported(false)) return 1;
+  reduced.time_step.reduce_min = nullptr;
+  if (!reduced.pipeline_supported(false)) return 1;
+
+  return 0;
+}
@@ -0,0 +1,38 @@
+#include <cstdio>
+#include "../includes/SPH_sweep.h"
+
+int main() {
+  SPH_run_config config;
+  config.dx = 0.5;
+  config.t_max = 0.05;
+  config.analytics = false;
+
+  // the same simulation twice next to a different one, all at the same time
+  std::vector<SPH_run_config> configs(3, config);
+  configs[0].name = "test_sweep_a";
+  configs[1].name = "test_sweep_b";
+  configs[2].name = "test_sweep_pc";
+  configs[2].predictor_corrector = true;
+
+  std::vector<SPH_run_summary> concurrent = run_sweep(configs, 3);
+  config.name = "test_sweep_serial";
+  SPH_run_summary serial = run_simulation(config);
+
+  for (const SPH_run_config& run : configs)
+    std::remove((run.name + "_summary.json").c_str());
+  std::remove("test_sweep_serial_summary.json");
+
+  if (concurrent.size() != 3) return 1;
+  for (const SPH_run_summary& summary : concurrent)
+    if (summary.status != 0 || summary.steps == 0) return 1;
+  if (concurrent[0].name != "test_sweep_a" || concurrent[2].name != "test_sweep_pc") return 1;
+
+  // no state is shared, so running next to other simulations changes nothing
+  for (int r = 0; r < 2; r++) {
+    if (concurrent[r].steps != serial.steps) return 1;
+    if (concurrent[r].kinetic_energy != serial.kinetic_energy) return 1;
+    if (concurrent[r].max_velocity != serial.max_velocity) return 1;
+  }
+  if (serial.kinetic_energy <= 0) return 1;
+  return 0;
+}
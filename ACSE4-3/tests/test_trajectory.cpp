@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include "../includes/SPH_2D.h"
+#include "../includes/SPH_trajectory.h"
+
+// the particles of frame f, in the order the simulation might hold them
+static std::vector<SPH_particle> frame(int f, int n) {
+  std::vector<SPH_particle> particle_list(n);
+  for (int i = 0; i < n; i++) {
+    SPH_particle& part = particle_list[i];
+    part.id = i;
+    part.boundary_status = i < n / 4;
+    double moving = part.boundary_status ? 0 : 1;
+    part.x[0] = 0.1 * (i % 20) + moving * 0.013 * f * std::sin(i);
+    part.x[1] = 0.1 * (i / 20) + moving * 0.011 * f * std::cos(i);
+    part.v[0] = moving * std::sin(i + 0.1 * f);
+    part.v[1] = moving * std::cos(i - 0.1 * f);
+    part.rho = 1000 + 0.5 * std::sin(0.3 * i + f);
+    part.calculate_P();
+  }
+  std::shuffle(particle_list.begin() + n / 4, particle_list.end(), std::mt19937(f));
+  return particle_list;
+}
+
+static int check(SPH_trajectory_reader& reader, int f, int n) {
+  std::vector<SPH_particle> particle_list;
+  if (reader.read_frame(f, particle_list)) return 1;
+  if (int(particle_list.size()) != n) return 1;
+  if (reader.index[f].step != 10 * f) return 1;
+
+  std::vector<SPH_particle> original = frame(f, n);
+  std::sort(original.begin(), original.end(), [](const SPH_particle& a, const SPH_particle& b) { return a.id < b.id; });
+  for (int i = 0; i < n; i++) {
+    const SPH_particle& a = particle_list[i];
+    const SPH_particle& b = original[i];
+    if (a.id != b.id || a.boundary_status != b.boundary_status) return 1;
+    for (int d = 0; d < 2; d++)
+      if (std::fabs(a.x[d] - b.x[d]) > 0.5001 * reader.header.quantum) return 1;
+    if (a.v[0] != float(b.v[0]) || a.v[1] != float(b.v[1]) || a.rho != float(b.rho) || a.P != float(b.P)) return 1;
+  }
+  return 0;
+}
+
+int main() {
+  const char* filename = "test_trajectory.traj";
+  const int n = 400;
+
+  SPH_main domain;
+  domain.set_values(1.3, 0.1, 1.0);
+  domain.initialise_grid();
+
+  SPH_trajectory_writer writer;
+  writer.keyframe_interval = 4;
+  if (writer.open(filename, domain)) return 1;
+  for (int f = 0; f < 10; f++)
+    if (writer.write_frame(frame(f, n), 0.01 * f, 10 * f) == 0) return 1;
+  writer.close();
+
+  // a restarted run continues the file
+  if (writer.open(filename, domain, true)) return 1;
+  for (int f = 10; f < 13; f++)
+    writer.write_frame(frame(f, n), 0.01 * f, 10 * f);
+  writer.close();
+
+  SPH_trajectory_reader reader;
+  if (reader.open(filename)) return 1;
+  if (reader.index.size() != 13) return 1;
+  if (!reader.index[0].keyframe || reader.index[1].keyframe || !reader.index[4].keyframe || !reader.index[10].keyframe) return 1;
+
+  // any order, forwards, backwards and repeated
+  for (int f : { 7, 0, 12, 3, 4, 5, 5, 9, 1 })
+    if (check(reader, f, n)) return 1;
+  std::vector<SPH_particle> beyond;
+  if (!reader.read_frame(13, beyond)) return 1;
+
+  std::remove(filename);
+  return 0;
+}
@@ -0,0 +1,90 @@
+/* ***************************************************************************
+*  This file is part of SPH_2D.                                              *
+*                                                                            *
+*  This program is free software; you can redistribute it and/or modify      *
+*  it under the terms of the GNU General Public License version 3 as         *
+*  published by the Free Software Foundation.                                *
+*                                                                            *
+*  @file     trajectory_to_vtk.cpp                                           *
+*  @brief    converts frames of a trajectory file to VTK files               *
+*  Details.                                                                  *
+*  usage: trajectory_to_vtk [-o prefix] [-f first] [-l last] [-e every]      *
+*                           [-i] run.traj                                    *
+*                                                                            *
+*  @author   LINAONA ZHU, PING-CHEN TSAI, XUN XIE                            *
+*  @version  1.0.0.19                                                        *
+*  @date     2020/03/21                                                      *
+*  @license  GNU General Public License (GPL)                                *
+*                                                                            *
+*****************************************************************************/
+
+#include <cstring>
+#include "../includes/SPH_2D.h"
+#include "../includes/SPH_trajectory.h"
+#include "../includes/file_writer.h"
+
+// writes frames first to last (default: all) of run.traj, every e-th, to <prefix>_<frame>.vtp with all fields;
+// -i only lists the frames
+int main(int argc, char** argv)
+{
+    string prefix = "frame";
+    long first = 0, last = -1, every = 1;
+    bool list = false;
+    const char* input = nullptr;
+
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "-o") == 0 && a + 1 < argc)
+            prefix = argv[++a];
+        else if (strcmp(argv[a], "-f") == 0 && a + 1 < argc)
+            first = atol(argv[++a]);
+        else if (strcmp(argv[a], "-l") == 0 && a + 1 < argc)
+            last = atol(argv[++a]);
+        else if (strcmp(argv[a], "-e") == 0 && a + 1 < argc)
+            every = max(1L, atol(argv[++a]));
+        else if (strcmp(argv[a], "-i") == 0)
+            list = true;
+        else
+            input = argv[a];
+    }
+
+    if (input == nullptr)
+    {
+        cerr << "usage: trajectory_to_vtk [-o prefix] [-f first] [-l last] [-e every] [-i] run.traj" << endl;
+        return 1;
+    }
+
+    SPH_trajectory_reader reader;
+    if (reader.open(input))
+        return 1;
+
+    long n_frames = long(reader.index.size());
+    if (list)
+    {
+        cout << "frame,step,time,keyframe,offset" << endl;
+        for (long f = 0; f < n_frames; f++)
+        {
+            const SPH_trajectory_entry& entry = reader.index[f];
+            cout << f << ',' << entry.step << ',' << entry.time << ',' << entry.keyframe << ',' << entry.offset << endl;
+        }
+        return 0;
+    }
+
+    if (last < 0 || last >= n_frames)
+        last = n_frames - 1;
+
+    vector<SPH_particle> particle_list;
+    for (long f = max(first, 0L); f <= last; f += every)
+    {
+        if (reader.read_frame(f, particle_list))
+        {
+            cerr << "frame " << f << " of " << input << " is damaged" << endl;
+            return 1;
+        }
+        string name = prefix + "_" + to_string(f) + ".vtp";
+        write_file_binary(name.c_str(), &particle_list, VTK_ALL_FIELDS);
+    }
+    cout << n_frames << " frames in " << input << endl;
+
+    return 0;
+}